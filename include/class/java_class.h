@@ -6,6 +6,7 @@
 
 #include <io/byte_reader.h>
 #include <io/byte_writer.h>
+#include <class/symbol.h>
 
 struct ConstantPoolInfo;
 struct ClassFile;
@@ -102,6 +103,7 @@ struct ClassFile
     static ClassFile read(ByteReader *bs);
     void write(ByteWriter *bs);
     std::string getUtf8(uint16_t index);
+    Symbol *getSymbol(uint16_t index);
     std::string getIndexName(uint16_t index);
 };
 
@@ -137,9 +139,26 @@ struct Const32Info : ConstantPoolInfo
     void write(ByteWriter *bs);
 };
 
+struct Const64Info : ConstantPoolInfo
+{
+    uint64_t value;
+
+    static Const64Info *read(ByteReader *bs);
+    void write(ByteWriter *bs);
+};
+
+/* Entry after a long or double, the pool has no constant there */
+struct UnusableInfo : ConstantPoolInfo
+{
+    UnusableInfo() { tag = 0; }
+    void write(ByteWriter *) {}
+};
+
 struct Utf8Info : ConstantPoolInfo
 {
     std::string str;
+    /* Interned copy of str, set when the entry is created */
+    Symbol *symbol = nullptr;
 
     static Utf8Info *read(ByteReader *bs);
     void write(ByteWriter *bs);
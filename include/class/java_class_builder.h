@@ -12,8 +12,8 @@
 class ClassBuilder;
 class MethodBuilder;
 class Label;
-class Frame;
-class FrameType;
+struct CodeFrame;
+struct FrameType;
 
 enum FrameTag
 {
@@ -26,9 +26,13 @@ class ClassBuilder
 public:
     ClassBuilder(std::string name);
     MethodBuilder *createMethod(std::string name);
+    /* Empty name means no superclass, only for java/lang/Object */
+    void setSuper(std::string superName);
+    void addField(std::string name, std::string descriptor, uint16_t flags);
     uint16_t addUtf8(std::string str);
     uint16_t addClass(std::string name);
     uint16_t addInteger(int32_t integer);
+    uint16_t addLong(int64_t value);
     uint16_t addString(std::string str);
     uint16_t addFieldRef(
         std::string className,
@@ -42,7 +46,8 @@ public:
 
 
 private:
-    std::string name;
+    std::string name, superName = "java/lang/Object";
+    std::vector<MemberInfo*> fields;
     
     std::vector<ConstantPoolInfo*> constantPool;
     uint16_t constCounter = 1;
@@ -76,8 +81,11 @@ public:
         std::string className,
         std::string method,
         std::string descriptor);
+    /* NEW and other instructions taking a class operand */
+    void type(uint8_t opCode, std::string className);
     void loadString(std::string str);
     void loadInteger(int32_t integer);
+    void loadLong(int64_t value);
     void local(uint8_t opCode, uint16_t index);
     void jump(uint8_t opCode, Label *label);
     void frameSame();
@@ -97,9 +105,9 @@ private:
     ByteBuffer *codeBuilder;
     ByteWriter *codeWriter;
     std::vector<Label*> labels;
-    std::vector<Frame*> frames;
+    std::vector<CodeFrame*> frames;
 
-    void frame(Frame *f);
+    void frame(CodeFrame *f);
     void loadRef(uint16_t ref);
     StackMapTableAttribute *buildStackMapTable();
 };
@@ -116,7 +124,8 @@ private:
     std::vector<uint32_t> refPositions;
 };
 
-struct Frame
+/* Stack map frame recorded while code is built */
+struct CodeFrame
 {
     uint8_t frameTag;
     /* Position in code */
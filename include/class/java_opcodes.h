@@ -15,17 +15,24 @@ public:
         ICONST_3      = 0x06,
         ICONST_4      = 0x07,
         ICONST_5      = 0x08,
+        LCONST_0      = 0x09,
+        LCONST_1      = 0x0A,
         BIPUSH        = 0x10,
         SIPUSH        = 0x11,
         LDC           = 0x12,
         LDC_W         = 0x13,
         LDC2_W        = 0x14,
         ILOAD         = 0x15,
+        LLOAD         = 0x16,
         ALOAD         = 0x19,
         ILOAD_0       = 0x1A,
         ILOAD_1       = 0x1B,
         ILOAD_2       = 0x1C,
         ILOAD_3       = 0x1D,
+        LLOAD_0       = 0x1E,
+        LLOAD_1       = 0x1F,
+        LLOAD_2       = 0x20,
+        LLOAD_3       = 0x21,
         ALOAD_0       = 0x2A,
         ALOAD_1       = 0x2B,
         ALOAD_2       = 0x2C,
@@ -33,11 +40,16 @@ public:
         IALOAD        = 0x2E,
         BALOAD        = 0x33,
         ISTORE        = 0x36,
+        LSTORE        = 0x37,
         ASTORE        = 0x3A,
         ISTORE_0      = 0x3B,
         ISTORE_1      = 0x3C,
         ISTORE_2      = 0x3D,
         ISTORE_3      = 0x3E,
+        LSTORE_0      = 0x3F,
+        LSTORE_1      = 0x40,
+        LSTORE_2      = 0x41,
+        LSTORE_3      = 0x42,
         ASTORE_0      = 0x4B,
         ASTORE_1      = 0x4C,
         ASTORE_2      = 0x4D,
@@ -45,19 +57,30 @@ public:
         IASTORE       = 0x4F,
         BASTORE       = 0x54,
         POP           = 0x57,
+        POP2          = 0x58,
         DUP           = 0x59,
         DUP_X1        = 0x5A,
         IADD          = 0x60,
+        LADD          = 0x61,
         ISUB          = 0x64,
+        LSUB          = 0x65,
         IMUL          = 0x68,
         IINC          = 0x84,
+        I2L           = 0x85,
+        L2I           = 0x88,
+        LCMP          = 0x94,
         IFNE          = 0x9A,
         IFEQ          = 0x99,
+        IFLT          = 0x9B,
+        IFGE          = 0x9C,
+        IFGT          = 0x9D,
+        IFLE          = 0x9E,
         IF_ICMPLT     = 0xA1,
         IF_ICMPGE     = 0xA2,
         IF_ICMPLE     = 0xA4,
         GOTO          = 0xA7,
         IRETURN       = 0xAC,
+        LRETURN       = 0xAD,
         ARETURN       = 0xB0,
         RETURN        = 0xB1,
         GETSTATIC     = 0xB2,
@@ -68,7 +91,9 @@ public:
         INVOKESPECIAL = 0xB7,
         INVOKESTATIC  = 0xB8,
         NEW           = 0xBB,
-        NEWARRAY      = 0xBC;
+        NEWARRAY      = 0xBC,
+        MONITORENTER  = 0xC2,
+        MONITOREXIT   = 0xC3;
 
     static const std::string names[];
 };
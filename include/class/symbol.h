@@ -0,0 +1,28 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/* Interned string, equal strings share one Symbol and compare by pointer */
+class Symbol
+{
+public:
+    const std::string str;
+
+    /* Symbols are never freed */
+    static Symbol *intern(const std::string &str);
+
+private:
+    Symbol(const std::string &str) : str(str) {}
+
+    static std::mutex lock;
+    static std::unordered_map<std::string, Symbol *> &table();
+};
+
+/* Name and descriptor of a member */
+typedef std::pair<Symbol *, Symbol *> SymbolPair;
+
+#endif /* SYMBOL_H */
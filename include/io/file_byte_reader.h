@@ -13,6 +13,7 @@ public:
     virtual ~FileByteReader();
 
     void read(uint8_t *buffer, size_t count);
+    bool isOpen() const { return f.is_open(); }
 
 private:
     std::ifstream f;
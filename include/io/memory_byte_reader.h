@@ -0,0 +1,25 @@
+#ifndef MEMORY_BYTE_READER_H
+#define MEMORY_BYTE_READER_H
+
+#include <io/byte_reader.h>
+
+/* Reads from a buffer owned by the caller, past the end reads zeros */
+class MemoryByteReader : public ByteReader
+{
+public:
+    MemoryByteReader(const uint8_t *data, size_t length);
+    virtual ~MemoryByteReader();
+
+    void read(uint8_t *buffer, size_t count);
+    size_t remaining() const { return length - position; }
+    /* True once a read went past the end */
+    bool overrun() const { return pastEnd; }
+
+private:
+    const uint8_t *data;
+    size_t length;
+    size_t position;
+    bool pastEnd;
+};
+
+#endif /* MEMORY_BYTE_READER_H */
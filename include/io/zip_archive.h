@@ -0,0 +1,45 @@
+#ifndef ZIP_ARCHIVE_H
+#define ZIP_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Read-only ZIP/JAR archive. The file is mapped once and its central
+ * directory indexed by name, entries are located through the index and
+ * inflated on demand. ZIP64 archives are not supported.
+ */
+class ZipArchive
+{
+public:
+    /* nullptr if the file is missing or not a ZIP archive */
+    static ZipArchive *open(const std::string &path);
+    ~ZipArchive();
+
+    bool contains(const std::string &name) const;
+    /* Stored entries point into the mapping, deflated ones are inflated
+     * into buffer; nullptr if absent or damaged */
+    const uint8_t *read(const std::string &name, size_t &length,
+            std::vector<uint8_t> &buffer) const;
+
+private:
+    struct Item
+    {
+        uint16_t method;
+        uint32_t compressedSize, size;
+        uint32_t localOffset;
+    };
+
+    const uint8_t *data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::unordered_map<std::string, Item> items;
+
+    ZipArchive() = default;
+    bool index();
+};
+
+#endif /* ZIP_ARCHIVE_H */
@@ -0,0 +1,61 @@
+#ifndef ALLOC_PROFILER_H
+#define ALLOC_PROFILER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct Class;
+struct Method;
+
+/* Frames kept for every sampled allocation site */
+const int ALLOC_STACK_DEPTH = 4;
+
+class AllocationProfiler
+{
+public:
+    static bool enabled;
+
+    /* One sample is taken per sampleBytes allocated */
+    static void enable(uint32_t sampleBytes);
+    static void record(Class *cls, uint32_t size);
+    static void report(std::ostream &out, size_t limit = 20);
+
+private:
+    struct Site
+    {
+        Method *methods[ALLOC_STACK_DEPTH];
+        uint32_t pcs[ALLOC_STACK_DEPTH];
+        int depth;
+
+        bool operator<(const Site &other) const;
+    };
+
+    /* Totals are estimated from weighted samples */
+    struct Stats
+    {
+        uint64_t samples = 0, bytes = 0;
+        double count = 0;
+
+        void add(uint64_t weight, uint32_t size);
+    };
+
+    static uint32_t sampleBytes;
+    static thread_local uint64_t bytesSinceSample;
+
+    static std::mutex statsLock;
+    static std::map<Class *, Stats> classStats;
+    static std::map<Site, Stats> siteStats;
+
+    typedef std::vector<std::pair<std::string, Stats>> Rows;
+
+    static void sample(Class *cls, uint32_t size);
+    static std::string siteName(const Site &site);
+    static void printTop(std::ostream &out, Rows rows,
+            bool byBytes, size_t limit);
+};
+
+#endif /* ALLOC_PROFILER_H */
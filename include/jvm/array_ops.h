@@ -0,0 +1,58 @@
+#ifndef ARRAY_OPS_H
+#define ARRAY_OPS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <jvm/jvm.h>
+
+/*
+ * Bulk operations on array elements behind the System.arraycopy and
+ * java.util.Arrays intrinsics. Vector code is picked at run time from
+ * what the CPU supports, the scalar code is the reference.
+ */
+class ArrayOps
+{
+public:
+    enum Level { SCALAR, SSE2, AVX2 };
+
+    /* Best level of this CPU */
+    static const Level supported;
+
+    static Level level() { return active; }
+    /* Lowers the level used, for comparing them */
+    static void limit(Level max);
+    static const char *levelName(Level level);
+
+    static int32_t length(Object *array)
+    {
+        return *reinterpret_cast<int32_t *>(array->fields);
+    }
+
+    template<typename T>
+    static T *items(Object *array)
+    {
+        return reinterpret_cast<T *>(array->fields + INTEGER_SIZE);
+    }
+
+    /* Ranges may overlap */
+    static void copy(void *dst, const void *src, size_t bytes);
+    /* Stores the itemSize bytes at value count times, itemSize is a
+     * power of two up to 8 */
+    static void fill(void *dst, const void *value, size_t itemSize,
+            size_t count);
+    static bool equals(const void *a, const void *b, size_t bytes);
+
+    /* Arrays.hashCode of the elements */
+    static int32_t hashCode(const int32_t *items, size_t count);
+    static int32_t hashCode(const int16_t *items, size_t count);
+    static int32_t hashCode(const uint16_t *items, size_t count);
+    static int32_t hashCode(const int8_t *items, size_t count);
+
+private:
+    static Level active;
+
+    static Level detect();
+};
+
+#endif /* ARRAY_OPS_H */
@@ -0,0 +1,33 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+struct ClassFile;
+
+/* Core classes built in memory, no class files are read for them */
+class Bootstrap
+{
+public:
+    /* Built on first request, nullptr if the class is not built in */
+    static ClassFile *find(const std::string &name);
+
+private:
+    typedef ClassFile *(*Builder)();
+
+    static const std::map<std::string, Builder> builders;
+    static std::mutex lock;
+    static std::map<std::string, ClassFile *> built;
+
+    static ClassFile *objectClass();
+    static ClassFile *stringClass();
+    static ClassFile *systemClass();
+    static ClassFile *printStreamClass();
+    static ClassFile *threadClass();
+    static ClassFile *mathClass();
+    static ClassFile *arraysClass();
+};
+
+#endif /* BOOTSTRAP_H */
@@ -0,0 +1,46 @@
+#ifndef CLASS_PATH_H
+#define CLASS_PATH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class ZipArchive;
+
+/* Directories and JAR/ZIP archives searched in order for class files */
+class ClassPath
+{
+public:
+    /* Entries separated by ':', archives are opened and indexed here */
+    static void set(const std::string &classPath);
+
+    /* Class bytes, either in an archive mapping or in buffer; nullptr if
+     * no entry has the class */
+    static const uint8_t *find(const std::string &className, size_t &length,
+            std::vector<uint8_t> &buffer);
+    /* Checks without reading the class */
+    static bool contains(const std::string &className);
+    /* File the class is read from, the class file of a directory or the
+     * archive holding it; empty if no entry has the class */
+    static std::string source(const std::string &className);
+    /* Without entries classes are loaded from the current directory */
+    static bool empty() { return entries.empty(); }
+
+private:
+    struct Entry
+    {
+        std::string directory;
+        ZipArchive *archive;
+    };
+
+    static std::vector<Entry> entries;
+
+    /* Classes no entry has, looked up again only after set */
+    static std::mutex missingLock;
+    static std::unordered_set<std::string> missing;
+};
+
+#endif /* CLASS_PATH_H */
@@ -0,0 +1,60 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Method;
+
+/* Stacks deeper than this are truncated at the outermost frames */
+const int CPU_STACK_DEPTH = 32;
+
+/* Frames seen by SIGPROF, written as collapsed stacks for flamegraphs */
+class CpuProfiler
+{
+public:
+    static std::atomic<bool> enabled;
+
+    static bool start(uint32_t hz, const std::string &outputPath);
+    /* Writes the profile, call after every Java thread finished */
+    static void stop();
+
+private:
+    /* Written by the signal handler, aggregated by the drain thread */
+    struct Sample
+    {
+        std::atomic<int> state{0};
+        int depth;
+        Method *methods[CPU_STACK_DEPTH];
+        uint32_t pcs[CPU_STACK_DEPTH];
+    };
+
+    typedef std::vector<std::pair<Method *, uint32_t>> Stack;
+
+    static const size_t bufferSize = 4096;
+    static Sample *buffer;
+    static std::atomic<size_t> nextSample;
+    static std::atomic<uint64_t> dropped, idle;
+
+    static std::string outputPath;
+    static std::map<Stack, uint64_t> stacks;
+    static std::thread drainThread;
+    static std::mutex drainLock;
+    static std::condition_variable drainCond;
+    static bool draining;
+
+    static void handler(int signal);
+    static void drainLoop();
+    static void drain();
+    static void write();
+    static std::string frameName(Method *m, uint32_t pc);
+    static int lineOf(Method *m, uint32_t pc);
+};
+
+#endif /* CPU_PROFILER_H */
@@ -0,0 +1,141 @@
+#ifndef EMBED_H
+#define EMBED_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <jvm/jvm.h>
+
+/*
+ * Embedding API. A MethodHandle is resolved once by name, a CallContext
+ * keeps one interpreter thread per native thread, so a call only pushes
+ * a frame in the thread's arena and runs it.
+ */
+class MethodHandle
+{
+public:
+    MethodHandle() = default;
+
+    /* Superclasses are searched too, invalid if nothing is found or the
+     * method has no bytecode */
+    static MethodHandle find(const std::string &className,
+            const std::string &name, const std::string &descriptor);
+
+    bool valid() const { return method != nullptr; }
+    Method *get() const { return method; }
+
+private:
+    Method *method = nullptr;
+
+    explicit MethodHandle(Method *method) : method(method) {}
+};
+
+/* Not for use from code running in the interpreter */
+class CallContext
+{
+public:
+    explicit CallContext(Isolate *isolate);
+
+    /* Context of the calling native thread, in the main isolate */
+    static CallContext &current();
+
+    /* Receiver comes first for instance methods */
+    template<typename... Args>
+    void callVoid(const MethodHandle &handle, Args... args)
+    {
+        invoke(handle, args...);
+    }
+
+    template<typename... Args>
+    int32_t callInt(const MethodHandle &handle, Args... args)
+    {
+        return static_cast<int32_t>(invoke(handle, args...));
+    }
+
+    template<typename... Args>
+    bool callBoolean(const MethodHandle &handle, Args... args)
+    {
+        return static_cast<int32_t>(invoke(handle, args...)) != 0;
+    }
+
+    template<typename... Args>
+    Object *callObject(const MethodHandle &handle, Args... args)
+    {
+        return reinterpret_cast<Object *>(invoke(handle, args...));
+    }
+
+    /*
+     * Batch calls: the method runs once per row with arguments taken
+     * from the columns at that row and its value stored to results[row].
+     * One frame is reused for every row.
+     */
+    template<typename... Columns>
+    void callIntBatch(const MethodHandle &handle, size_t rows,
+            int32_t *results, const Columns *... columns)
+    {
+        batch(handle, rows, results, columns...);
+    }
+
+    template<typename... Columns>
+    void callBooleanBatch(const MethodHandle &handle, size_t rows,
+            bool *results, const Columns *... columns)
+    {
+        batch(handle, rows, results, columns...);
+    }
+
+    template<typename... Columns>
+    void callObjectBatch(const MethodHandle &handle, size_t rows,
+            Object **results, const Columns *... columns)
+    {
+        batch(handle, rows, results, columns...);
+    }
+
+private:
+    Thread thread;
+
+    /* Values are kept in slots the way the interpreter keeps them */
+    static intptr_t slot(int32_t value) { return value; }
+    static intptr_t slot(bool value) { return value; }
+    static intptr_t slot(Object *value) { return reinterpret_cast<intptr_t>(value); }
+    static intptr_t slot(float value)
+    {
+        int32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static void store(int32_t &result, intptr_t value) { result = value; }
+    static void store(bool &result, intptr_t value) { result = static_cast<int32_t>(value) != 0; }
+    static void store(Object *&result, intptr_t value) { result = reinterpret_cast<Object *>(value); }
+
+    template<typename... Args>
+    intptr_t invoke(const MethodHandle &handle, Args... args)
+    {
+        const intptr_t slots[] = {slot(args)..., 0};
+        return thread.call(handle.get(), slots, sizeof...(Args));
+    }
+
+    template<typename Result, typename... Columns>
+    void batch(const MethodHandle &handle, size_t rows, Result *results,
+            const Columns *... columns)
+    {
+        Method *method = handle.get();
+        if (method->methodInfo->accessFlags & ACC_SYNCHRONIZED) {
+            for (size_t row = 0; row < rows; row++)
+                store(results[row], invoke(handle, columns[row]...));
+            return;
+        }
+
+        intptr_t *locals = thread.beginBatch(method);
+        for (size_t row = 0; row < rows; row++) {
+            const intptr_t slots[] = {slot(columns[row])..., 0};
+            for (size_t i = 0; i < sizeof...(Columns); i++)
+                locals[i] = slots[i];
+            store(results[row], thread.runRow());
+        }
+        thread.endBatch();
+    }
+};
+
+#endif /* EMBED_H */
@@ -0,0 +1,59 @@
+#ifndef ESCAPE_ANALYSIS_H
+#define ESCAPE_ANALYSIS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Method;
+
+struct EscapeInfo
+{
+    /* Pcs of NEW instructions whose objects never leave the method */
+    std::vector<uint32_t> localSites;
+    /* Bit i is set when the argument in local slot i may escape */
+    uint64_t escapingArgs = ~0ull;
+
+    bool isLocalSite(uint32_t pc);
+};
+
+class EscapeAnalysis
+{
+public:
+    /* Analysis runs once per method, on first request */
+    static EscapeInfo *get(Method *m);
+
+private:
+    /* Every value is a set of sources: arguments and allocation sites */
+    typedef uint64_t Sources;
+    static const int maxSources = 64;
+
+    struct State
+    {
+        bool reached = false;
+        uint16_t stackTop = 0;
+        std::vector<Sources> locals, stack;
+    };
+
+    Method *method;
+    uint16_t maxLocals, maxStack;
+    std::vector<State> states;
+    std::vector<uint32_t> worklist;
+    std::vector<uint32_t> sitePcs;
+    int argSources = 0;
+    Sources escaped = 0;
+    bool failed = false;
+
+    EscapeAnalysis(Method *m);
+    EscapeInfo *run();
+    void step(uint32_t pc, State &s);
+    void flow(uint32_t pc, State &s);
+    Sources siteSource(uint32_t pc);
+    void invoke(uint32_t pc, State &s, uint8_t opcode);
+
+    static void parseDescriptor(const std::string &descriptor,
+            std::vector<uint8_t> &argSlots, uint8_t &returnSlots);
+    static uint8_t slotsOf(char type);
+};
+
+#endif /* ESCAPE_ANALYSIS_H */
@@ -0,0 +1,64 @@
+#ifndef EXEC_COUNTERS_H
+#define EXEC_COUNTERS_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+struct Method;
+
+/* Counts what the interpreter executes, tables guide interpreter tuning */
+class ExecutionCounters
+{
+public:
+    static bool enabled;
+
+    static void enable();
+    /* Called for every instruction before it runs */
+    static void instruction(Method *m, uint8_t opcode)
+    {
+        Counters *c = counters;
+        if (c == nullptr)
+            c = attach();
+        c->opcodes[opcode]++;
+        c->pairs[c->previous][opcode]++;
+        c->previous = opcode;
+        if (m != c->lastMethod) {
+            c->lastMethod = m;
+            c->lastCounts = &c->methods[m];
+        }
+        c->lastCounts->instructions++;
+    }
+    static void invoked(Method *m);
+    static void report(std::ostream &out, size_t limit = 30);
+
+private:
+    struct MethodCounts
+    {
+        uint64_t instructions = 0, invocations = 0;
+    };
+
+    /* One per native thread, merged at report time */
+    struct Counters
+    {
+        uint64_t opcodes[256] = {};
+        /* Row 256 holds the first instruction of the thread */
+        uint64_t pairs[257][256] = {};
+        uint16_t previous = 256;
+        Method *lastMethod = nullptr;
+        MethodCounts *lastCounts = nullptr;
+        std::map<Method *, MethodCounts> methods;
+    };
+
+    static thread_local Counters *counters;
+    static std::mutex listLock;
+    static std::vector<Counters *> allCounters;
+
+    static Counters *attach();
+    static std::string opcodeName(uint8_t opcode);
+    static std::string methodName(Method *m);
+};
+
+#endif /* EXEC_COUNTERS_H */
@@ -0,0 +1,34 @@
+#ifndef HEAP_SNAPSHOT_H
+#define HEAP_SNAPSHOT_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+struct Class;
+class Isolate;
+struct Object;
+
+/*
+ * Runtime state after class initialization: initialized classes with
+ * their static fields, every object reachable from them or from string
+ * literals. References are stored as object indices and relocated on
+ * restore. Only taken while no other thread runs.
+ */
+class HeapSnapshot
+{
+public:
+    static bool save(const std::string &path, Isolate *isolate);
+    /* False if the file is missing or not of the length it records, a
+     * class is gone or its fields have changed */
+    static bool restore(const std::string &path, Isolate *isolate);
+
+private:
+    typedef std::function<void(uintptr_t &)> SlotVisitor;
+
+    static void staticReferences(Class *cls, uint8_t *statics,
+            const SlotVisitor &visit);
+    static void objectReferences(Object *obj, const SlotVisitor &visit);
+};
+
+#endif /* HEAP_SNAPSHOT_H */
@@ -0,0 +1,88 @@
+#ifndef ISOLATE_H
+#define ISOLATE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <jvm/jvm.h>
+
+/* Mutable part of a class, one per isolate the class is used in */
+struct ClassState
+{
+    /* Zero-initialized, laid out by the class */
+    uint8_t *staticFields = nullptr;
+
+    /* Guarded by Class::initLock, initDone is also read without it */
+    bool initStarted = false;
+    std::atomic<bool> initDone{false};
+    Thread *initThread = nullptr;
+    /* Green threads parked until initialization is done */
+    std::vector<Thread *> initWaiters;
+
+    /* Taken by static synchronized methods */
+    LockWord lockWord{0};
+};
+
+/*
+ * Independent program sharing loaded classes, methods and their code
+ * with others. Static fields, class initialization, class locks, string
+ * literals and heap accounting belong to the isolate.
+ */
+class Isolate
+{
+public:
+    const uint32_t id;
+    /* Bytes allocated by threads of this isolate */
+    std::atomic<uint64_t> allocatedBytes{0};
+
+    /* Isolate of the launcher and of code not running in a thread */
+    static Isolate *main();
+    /* Isolate of the running thread, main() outside the interpreter */
+    static Isolate *current();
+
+    Isolate();
+    ~Isolate();
+
+    /* Created on first use, the class gets linked then */
+    ClassState *state(Class *cls);
+
+    /* One object per distinct literal text */
+    Object *literal(Symbol *text);
+    /* Literal table as is, for heap snapshots */
+    std::map<Symbol *, Object *> literalTable();
+    void addLiteral(Symbol *text, Object *str);
+
+private:
+    static const uint32_t chunkBits = 8;
+    static const uint32_t chunkSize = 1 << chunkBits;
+    /* Room for a million classes, chunks are allocated when reached */
+    static const uint32_t chunkCount = 4096;
+
+    typedef std::atomic<ClassState *> Slot;
+
+    /* Readers never lock, states and chunks are only ever added */
+    std::atomic<Slot *> chunks[chunkCount];
+    std::mutex stateLock;
+
+    std::mutex literalsLock;
+    std::map<Symbol *, Object *> literals;
+
+    ClassState *createState(Class *cls);
+};
+
+inline ClassState *Isolate::state(Class *cls)
+{
+    Slot *chunk = chunks[cls->id >> chunkBits].load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+        ClassState *classState =
+                chunk[cls->id & (chunkSize - 1)].load(std::memory_order_acquire);
+        if (classState != nullptr)
+            return classState;
+    }
+    return createState(cls);
+}
+
+#endif /* ISOLATE_H */
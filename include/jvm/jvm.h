@@ -1,10 +1,18 @@
 #ifndef JVM_H
 #define JVM_H
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <mutex>
 #include <stack>
+#include <thread>
+#include <vector>
 
 #include <class/java_class.h>
+#include <jvm/stack_arena.h>
+#include <jvm/natives.h>
+#include <jvm/monitor.h>
 
 class ClassLoader;
 struct Class;
@@ -12,6 +20,8 @@ class ClassCache;
 struct Object;
 struct Method;
 struct Frame;
+struct EscapeInfo;
+class Isolate;
 class Interpreter;
 class Thread;
 
@@ -41,40 +51,96 @@ const int
 class ClassLoader
 {
 public:
-    /* Now load only from current dir */
+    /* From the class path if one is set, else from the current
+     * directory; nullptr if the class is not there */
     static Class *loadClass(std::string path);
 
+    /* Registers a class named by its this_class entry, nullptr if the
+     * bytes are not a class file or a class with that name is already
+     * loaded or being loaded */
+    static Class *defineClass(const uint8_t *data, size_t length);
+    /* The class file is used as is and must stay alive */
+    static Class *defineClass(ClassFile *cf);
+    /* True if loadClass would find the class */
+    static bool canLoad(const std::string &path);
+
 private:
     static Class *loadClass(ByteReader *br);
     static Class *loadClass(ClassFile *cf);
 };
 
+struct Field
+{
+    Symbol *name, *descriptor;
+    uint16_t offset;
+    /* First descriptor character, type of the stored value */
+    char type;
+    bool isStatic;
+};
+
+/* Method of a linked class, the Method is built on first lookup */
+struct MethodEntry
+{
+    Symbol *name, *descriptor;
+    MemberInfo *info;
+    std::atomic<Method *> method{nullptr};
+};
+
+/*
+ * Classes are loaded when first named, linked (superclass, layout and
+ * method table) when first used and initialized before first access.
+ */
 struct Class
 {
-    ClassFile *classFile;
+    /* Index of the class in per-isolate state tables */
+    const uint32_t id;
+    std::string name;
+    ClassFile *classFile = nullptr;
 
-    Class *super;
+    /* Valid once linked */
+    Class *super = nullptr;
+    std::atomic<bool> linked{false};
 
     Method *classInit = nullptr;
-    bool initDone = false, initStarted = false;
-    Thread *initThread = nullptr;
+
+    /* Guards class initialization in every isolate */
+    static std::mutex initLock;
+    static std::condition_variable initCond;
+    /* Linking may link superclasses and build methods recursively */
+    static std::recursive_mutex linkLock;
 
     uint16_t staticFieldsLength = 0, fieldsLength = 0;
-    std::map<std::string, uint16_t> fieldOffset;
-    std::map<std::string, std::string> descriptors;
-    std::vector<std::string> fieldNames, staticFieldNames;
-    uint8_t *staticFields;
+    /* Declared fields sorted by name symbol, searched by pointer */
+    std::vector<Field> fields;
+
+    /* Sorted by name and descriptor symbols */
+    MethodEntry *methods = nullptr;
+    uint16_t methodsCount = 0;
 
-    std::map<std::string, Method*> methods;
+    /* Classes named by constant pool entries, by index - 1, set on
+     * first use; allocated when linked */
+    std::atomic<Class *> *resolvedClasses = nullptr;
 
-    static uint8_t fieldSize(std::string descriptor);
+    static uint8_t fieldSize(const std::string &descriptor);
 
     Class(ClassFile *classFile);
+    /* Links the superclass chain first, cheap once done */
+    void link();
     Object *newObject();
-    Method *getMethod(std::string name, std::string descriptor);
+    /* Declared in this class only, superclasses are not searched */
+    Field *findField(Symbol *name);
+    Method *getMethod(Symbol *name, Symbol *descriptor);
+    /* Class of a CONSTANT_Class entry, named only on first use */
+    Class *resolveClass(uint16_t index);
+    /* Interns both strings, for callers outside the interpreter */
+    Method *getMethod(const std::string &name, const std::string &descriptor);
 
 protected:
     Class();
+
+private:
+    void linkClass();
+    Method *findMethod(Symbol *name, Symbol *descriptor);
 };
 
 struct ArrayClass : Class
@@ -89,25 +155,67 @@ struct ArrayClass : Class
     ArrayClass(uint8_t basePrimitive);
 
     Object *newArray(int32_t length); // Array creation
+    uint8_t itemSize();
 };
 
 class ClassCache
 {
 public:
-    static Class *getClass(std::string path);
+    static Class *getClass(const std::string &path);
+    /* Never loads, nullptr if the class is not loaded yet */
+    static Class *findLoaded(const std::string &path);
+    /* Every class published so far, in no particular order */
+    static std::vector<Class *> loadedClasses();
+    /* Publishes a class built elsewhere, false if the name is taken */
+    static bool define(const std::string &path, Class *cls);
 
 private:
-    /* Mapping from class name to class itself */
-    static std::map<std::string, Class*> classMap;
+    struct Entry
+    {
+        std::string name;
+        size_t hash;
+        Class *cls;
+    };
+
+    /* Open addressing, slots are only ever filled */
+    struct Table
+    {
+        size_t mask, used;
+        std::atomic<Entry *> *slots;
+
+        Table(size_t capacity);
+        Entry *find(const std::string &name, size_t hash);
+        void insert(Entry *entry);
+    };
+
+    static const size_t frontCacheSize = 64;
+
+    /* Readers never lock, writers are serialized by tableLock */
+    static std::atomic<Table *> table;
+    static std::mutex tableLock;
+    /* Classes being loaded and threads loading them */
+    static std::map<std::string, std::thread::id> loading;
+    static std::condition_variable loadedCond;
+
+    static thread_local Entry *frontCache[frontCacheSize];
+
+    static Entry *lookup(const std::string &path, size_t hash);
+    static Class *load(const std::string &path);
+    static void publish(const std::string &path, size_t hash, Class *cls);
 };
 
 struct Object
 {
     Class *cls;
+    LockWord lockWord;
     uint8_t fields[1];
 
     static Object *newObject(Class *cls);
     static Object *newArray(ArrayClass *cls, uint32_t length);
+    /* Object which is released together with the frame */
+    static Object *newLocalObject(Class *cls, StackArena *arena);
+
+    uint32_t blockSize();
 
 private:
     static Object *newObjectBlock(Class *cls, uint32_t size);
@@ -117,14 +225,23 @@ struct Method
 {
     Class *owner;
     MemberInfo *methodInfo;
-    CodeAttribute *codeAttr;
+    Symbol *name, *descriptor;
+    CodeAttribute *codeAttr = nullptr;
     uint32_t codeLength;
     uint8_t *code;
 
-    std::vector<std::string> argDescriptors;
-    std::string returnDescriptor;
+    /* Parsed descriptor: one type code per argument, 'V' for void */
+    std::string argTypes;
+    char returnType;
+    /* Operand slots taken by arguments, receiver not included */
+    uint16_t argSlots = 0;
 
     bool isInit = false;
+    NativeMethod nativeCode = nullptr;
+
+    /* Filled on first allocation in method */
+    std::atomic<EscapeInfo *> escapeInfo{nullptr};
+    bool escapeAnalyzing = false;
 
     Method(Class *owner, MemberInfo *info);
 };
@@ -138,31 +255,83 @@ struct Frame
     intptr_t *stack, *locals;
     uint16_t stackTop, maxStack, maxLocals;
     uint8_t *code;
+    /* Frame itself and frame-local objects are above this mark */
+    StackArena::Mark arenaMark;
+    /* Lock released on return from a synchronized method */
+    LockWord *monitor = nullptr;
 
-    Frame(Method *m);
-    ~Frame();
+    /* Operand stack and then locals are taken from slots */
+    Frame(Method *m, intptr_t *slots);
 };
 
 class Thread
 {
 public:
-    void invoke(Method *m);
+    /* Thread running on the current native thread */
+    static thread_local Thread *current;
+
+    /* Owner id stored in thin lock words, never zero */
+    const uint32_t lockId;
+    /* Statics and class initialization seen by this thread */
+    Isolate *const isolate;
+    /* java.lang.Thread object run by this thread, if any */
+    Object *threadObject = nullptr;
+    /* Set when the thread has to wait for another one, green threads
+     * are then registered with what they wait for */
+    bool blocked = false;
+    /* Scheduler::ParkState of a green thread */
+    std::atomic<uint8_t> parkState{0};
+    WaitState waitState;
+    /* Nesting of safe regions, outside the interpreter the thread is safe */
+    int safeDepth = 1;
+
+    Thread();
+    explicit Thread(Isolate *isolate);
+    void invoke(Method *m, const std::vector<intptr_t> &args = {});
+    /* Sets up the call without running it */
+    void prepare(Method *m, const std::vector<intptr_t> &args = {});
+    void prepare(Method *m, const intptr_t *args, size_t count);
+    /* Initializes the class if needed, runs the method to completion and
+     * returns the value of int and reference methods */
+    intptr_t call(Method *m, const intptr_t *args, size_t count);
+
+    /* Runs one method many times in a single frame: arguments of a row
+     * go to the returned locals, runRow runs it and returns its value.
+     * Synchronized methods are not supported. */
+    intptr_t *beginBatch(Method *m);
+    intptr_t runRow();
+    void endBatch();
+    Frame *currentFrame() { return top; }
 
     void pushMethod(Method *m);
     void pushFrame(Frame *f);
     void popFrame();
     Frame *newFrame(Method *m);
 
-    void prepareInit(Class *c);
+    /* False if nothing has to be initialized or the thread blocked */
+    bool prepareInit(Class *c);
+    /* Runs class initialization only, nothing else is invoked */
+    void initialize(Class *c);
 
-    void runLoop();
+    /* False if the thread yielded and has to be resumed later */
+    bool runLoop();
 
 
 
 private:
-    std::stack<Method *> initStack;
+    /* Classes left to initialize, nullptr starts each batch */
+    std::stack<Class *> initStack;
+    StackArena arena;
+    uint32_t quantumLeft;
+
+    /* Lock of the entry method, taken when the thread starts running */
+    LockWord *entryLock = nullptr;
+    Frame *entryFrame = nullptr;
 
     Frame *top = nullptr, *prev;
+    /* Frame of the batch being run, returns from it keep it pushed */
+    Frame *batchFrame = nullptr;
+    StackArena::Mark rowMark;
     uint32_t pc;
     uint8_t *code;
     intptr_t *locals, *stack;
@@ -170,21 +339,34 @@ private:
 
     Class *frameClass, *memberClass;
     RefInfo *ref;
-    std::string memberName, descriptor;
-    bool isRef, isWide;
+    Symbol *memberName, *descriptor;
+    char fieldType;
+    bool isRef, isWide, isInit;
     uint16_t offset;
     uint8_t *fieldPtr;
     bool instanceMethod;
     Method *resolvedMethod;
     Object *tmpObject;
-    uint32_t ret;
+    intptr_t ret;
 
     void loadFrame();
     void saveFrame();
 
+    bool prepareInit(Class *c, std::unique_lock<std::mutex> &lock);
     void pushInit();
+    bool enterInit();
+    void finishInit(Class *c);
+    bool invokeResolved();
+    bool invokeNative();
+    LockWord *methodLock();
+    bool enterMonitor(LockWord &word);
+    bool execute();
+    bool jump();
+    bool poll();
+    bool preempt();
     bool prepareClass(bool ofMember);
     void prepareMember();
+    void loadConstant(uint16_t index);
     bool prepareStaticField();
     void prepareField();
     bool prepareMethod();
@@ -192,6 +374,7 @@ private:
     void loadField();
     void storeField();
     void loadArgs();
+    void newObject();
     void newArray(uint8_t type);
     template<typename T> T *arrayPointer(uint16_t stackOffset, int32_t index);
     void loadIntArray();
@@ -203,6 +386,9 @@ private:
 class Debug
 {
 public:
+    /* Dump call stack before every instruction */
+    static bool trace;
+
     static void debugCallStack(Frame *top);
     static void debugFrame(Frame *frame);
     static void debugObject(Object *obj, int depth=1);
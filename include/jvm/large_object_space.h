@@ -0,0 +1,27 @@
+#ifndef LARGE_OBJECT_SPACE_H
+#define LARGE_OBJECT_SPACE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Blocks of at least this size get a mapping of their own */
+const uint32_t LARGE_OBJECT_THRESHOLD = 64 * 1024;
+
+/* Transparent huge page size, mappings above it are aligned to it */
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/* Objects are never freed, so regions are never unmapped */
+class LargeObjectSpace
+{
+public:
+    static bool isLarge(uint32_t size);
+
+    /* Memory returned is already zeroed */
+    static uint8_t *allocate(uint32_t size);
+
+private:
+    static size_t regionLength(uint32_t size);
+    static uint8_t *mapRegion(size_t length);
+};
+
+#endif /* LARGE_OBJECT_SPACE_H */
@@ -0,0 +1,79 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+class Thread;
+
+/*
+ * Lock word states:
+ *   0                               unlocked
+ *   owner << 8 | (recursion << 1)   thin lock, owner is Thread::lockId
+ *   Monitor * | 1                   inflated lock
+ */
+typedef std::atomic<uintptr_t> LockWord;
+
+class Monitor;
+
+/* Object.wait in progress on a green thread */
+struct WaitState
+{
+    Monitor *monitor = nullptr;
+    uint32_t recursion = 0;
+    bool notified = false, timed = false;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+class Monitor
+{
+public:
+    static void enter(LockWord &word, Thread *thread);
+    static bool tryEnter(LockWord &word, Thread *thread);
+    /* Never blocks, a green thread that does not get the lock is woken
+     * when it is released and calls again */
+    static bool enterGreen(LockWord &word, Thread *thread);
+    /* False if the thread does not own the lock */
+    static bool exit(LockWord &word, Thread *thread);
+    static bool wait(LockWord &word, Thread *thread, int64_t millis = 0);
+    /* Non-blocking wait, called again when the thread is woken until it
+     * returns true */
+    static bool waitGreen(LockWord &word, Thread *thread, int64_t millis = 0);
+    static bool notify(LockWord &word, Thread *thread, bool all);
+
+private:
+    std::mutex mutex;
+    std::condition_variable entered, notified;
+    uint32_t owner, recursion;
+    /* Green waiters and notifications they may consume */
+    uint32_t waiters = 0, permits = 0;
+    /* Parked green threads waiting for the lock and for a notification */
+    std::deque<Thread *> entrants, waitingTasks;
+
+    Monitor(uint32_t owner, uint32_t recursion);
+
+    void lock(uint32_t id);
+    bool tryLock(uint32_t id);
+    bool unlock(uint32_t id);
+    /* Called with the lock just given up, mutex held */
+    void released();
+
+    static void wakeOne(std::deque<Thread *> &tasks);
+    static void addTask(std::deque<Thread *> &tasks, Thread *thread);
+    static void removeTask(std::deque<Thread *> &tasks, Thread *thread);
+
+    static const uintptr_t inflatedBit = 1;
+    static const int ownerShift = 8;
+    static const uintptr_t recursionUnit = 2;
+    static const uintptr_t recursionMask = 0xFE;
+
+    static Monitor *inflated(uintptr_t value);
+    /* Inflates the lock in any state, owner is kept */
+    static Monitor *inflate(LockWord &word);
+};
+
+#endif /* MONITOR_H */
@@ -0,0 +1,40 @@
+#ifndef NATIVES_H
+#define NATIVES_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class Thread;
+
+/* Arguments are the operand stack slots, receiver first. Long values
+ * take two slots with the value in the first one. */
+typedef intptr_t (*NativeMethod)(Thread *thread, intptr_t *args);
+
+/*
+ * Registry of C++ method bodies keyed by "class.name:descriptor". A method
+ * is bound when it is built, calls to it then run the function on the
+ * caller's operand stack without pushing a frame. Methods with bytecode
+ * are replaced too, which is how library methods are intrinsified.
+ */
+class Natives
+{
+public:
+    /* Runtime implementation of a method, nullptr if there is none */
+    static NativeMethod find(const std::string &className,
+            const std::string &name, const std::string &descriptor);
+    /* Methods already built keep their binding */
+    static void add(const std::string &className, const std::string &name,
+            const std::string &descriptor, NativeMethod code);
+
+private:
+    static std::mutex lock;
+    static std::unordered_map<std::string, NativeMethod> registry;
+
+    static std::string key(const std::string &className,
+            const std::string &name, const std::string &descriptor);
+    static void addBuiltins();
+};
+
+#endif /* NATIVES_H */
@@ -0,0 +1,47 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+struct Class;
+
+/*
+ * Background threads loading the classes named in constant pools of
+ * loaded classes before the interpreter asks for them. Classes are only
+ * loaded and published, never linked or initialized.
+ */
+class Prefetcher
+{
+public:
+    static std::atomic<bool> enabled;
+
+    static void start(unsigned threadCount);
+    /* Drops pending work and the names already queued, waits for loads
+     * in progress */
+    static void stop();
+    /* Called after a class is published */
+    static void classLoaded(Class *cls);
+
+private:
+    static std::mutex lock;
+    static std::condition_variable workCond;
+    static std::deque<std::string> pending;
+    static std::unordered_set<std::string> seen;
+    static std::vector<std::thread> workers;
+    static bool stopping;
+    static bool exitHookAdded;
+
+    static void work();
+    static void requestStop();
+    /* At exit, joinable workers would terminate the process */
+    static void abandon();
+};
+
+#endif /* PREFETCHER_H */
@@ -0,0 +1,75 @@
+#ifndef SAFEPOINT_H
+#define SAFEPOINT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+class Thread;
+
+/*
+ * Threads poll on method entry and backward branches. Threads blocked
+ * outside the interpreter are in a safe region and count as stopped.
+ */
+class Safepoint
+{
+public:
+    /* Single load on the poll fast path */
+    static std::atomic<bool> requested;
+
+    /* Returns when every running thread is stopped, not for interpreter threads */
+    static void begin();
+    static void end();
+
+    /* Slow path of a poll, the thread frame must be saved */
+    static void block(Thread *thread);
+    static void enterSafeRegion(Thread *thread);
+    static void leaveSafeRegion(Thread *thread);
+
+    /* Brings threads to a safepoint every intervalMillis until stopped */
+    static void startPeriodic(uint32_t intervalMillis);
+    static void stopPeriodic();
+    static void report(std::ostream &out);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static std::mutex lock;
+    static std::condition_variable stoppedCond, resumedCond;
+    static int running;
+    static bool active;
+    static Clock::time_point beginTime;
+
+    /* Time to safepoint and pause totals, in microseconds */
+    static uint64_t count, ttspTotal, ttspMax, pauseTotal, pauseMax;
+
+    static std::thread periodicThread;
+    static std::mutex periodicLock;
+    static std::condition_variable periodicCond;
+    static bool periodicStop;
+
+    static void periodic(uint32_t intervalMillis);
+};
+
+/* Marks a thread that may block outside the interpreter */
+class SafeRegion
+{
+public:
+    SafeRegion(Thread *thread) : thread(thread)
+    {
+        Safepoint::enterSafeRegion(thread);
+    }
+    ~SafeRegion()
+    {
+        Safepoint::leaveSafeRegion(thread);
+    }
+
+private:
+    Thread *thread;
+};
+
+#endif /* SAFEPOINT_H */
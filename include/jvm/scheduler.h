@@ -0,0 +1,74 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Thread;
+
+/*
+ * M:N mode, Java threads are tasks run by a fixed pool of workers.
+ * A task that has to wait registers itself with what it waits for and is
+ * parked when it returns from runLoop; whoever releases it wakes it up.
+ */
+class Scheduler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /* Thread::parkState values */
+    enum ParkState : uint8_t { RUNNING, PARKED, WAKE_PENDING };
+
+    static bool active;
+    /* Preemption polls a task may pass before it is switched out */
+    static const uint32_t quantum = 10000;
+
+    /* Runs until the main tasks and every task they started finish */
+    static void run(const std::vector<Thread *> &mainTasks, unsigned workerCount);
+    static void submit(Thread *task);
+
+    /* Puts a parked task back on a run queue. Callers hold the lock the
+     * task takes to stop waiting, so the task cannot finish meanwhile. */
+    static void wake(Thread *task);
+    /* Wakes the task at deadline unless cancelled first */
+    static void wakeAt(Thread *task, Clock::time_point deadline);
+    static void cancelWake(Thread *task);
+
+private:
+    struct RunQueue
+    {
+        std::mutex lock;
+        std::deque<Thread *> tasks;
+    };
+
+    static std::vector<RunQueue *> queues;
+    static std::atomic<size_t> liveTasks, queuedTasks, nextQueue;
+    static std::mutex idleLock;
+    static std::condition_variable idleCond;
+    static thread_local int workerIndex;
+
+    /* Timed waits, timerLock is taken before queue locks */
+    static std::mutex timerLock;
+    static std::multimap<Clock::time_point, Thread *> timers;
+    /* Earliest deadline in ticks, noTimer if there is none */
+    static std::atomic<Clock::rep> nextTimer;
+    static const Clock::rep noTimer;
+
+    static void work(int index);
+    static void enqueue(Thread *task);
+    /* Own queue first, then steal from the others */
+    static Thread *take(int index);
+    static void park(Thread *task);
+    static void finish(Thread *task);
+    static void fireTimers();
+    static void updateNextTimer();
+    static void notifyIdle(bool all);
+};
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,135 @@
+#ifndef SHARED_ARCHIVE_H
+#define SHARED_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ClassFile;
+class Symbol;
+
+/*
+ * Classes of a previous run, mapped read-only and shared between
+ * processes. A class is stored parsed: constant pool and members as
+ * fixed records, names in one string table of the archive. Loading
+ * builds the ClassFile from the records without reading class bytes,
+ * and a name is interned once per process however many classes use
+ * it. Each entry remembers the file its class came from, a class file
+ * or a JAR of the class path, with its size and mtime, and is ignored
+ * once the class comes from elsewhere or the file changes.
+ */
+class SharedArchive
+{
+public:
+    static bool recording;
+
+    /* False if the archive is missing or was written by another build */
+    static bool open(const std::string &path);
+    /* True if the class is archived and up to date */
+    static bool contains(const std::string &className);
+    /* Class built from the archive, nullptr if absent or out of date.
+     * Its code stays in the mapping. */
+    static ClassFile *load(const std::string &className);
+
+    /* Reads the class through the class path, or from the current
+     * directory without one, and keeps its bytes for dump */
+    static const std::vector<uint8_t> &record(const std::string &className);
+    /* Parses the recorded classes and writes them as records */
+    static bool dump(const std::string &path);
+
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t count;
+        uint32_t stringCount;
+    };
+
+    /* Entries follow the header, sorted by class name, and point to a
+     * ClassRecord */
+    struct Entry
+    {
+        uint32_t nameOffset, nameLength;
+        uint32_t dataOffset, dataLength;
+        /* Path of the source file in the string table */
+        uint32_t sourceIndex;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+    };
+
+    /* String table follows the entries, Utf8 constants index it */
+    struct StringEntry
+    {
+        uint32_t offset, length;
+    };
+
+    /* Offsets are from the start of the record */
+    struct ClassRecord
+    {
+        uint16_t minorVersion, majorVersion;
+        uint16_t constantPoolCount, accessFlags;
+        uint16_t thisClass, superClass;
+        uint16_t interfacesCount, fieldsCount;
+        uint16_t methodsCount;
+        uint32_t poolOffset, interfacesOffset, membersOffset;
+    };
+
+    /* Utf8 values are string indices, entries after a long or double
+     * have tag 0 */
+    struct PoolRecord
+    {
+        uint8_t tag;
+        uint16_t first, second;
+        uint64_t value;
+    };
+
+    /* Fields, then methods. Attribute names are pool indices, 0 if the
+     * attribute is absent; only what the VM reads is kept. */
+    struct MemberRecord
+    {
+        uint16_t accessFlags, nameIndex, descriptorIndex;
+        uint16_t codeName, maxStack, maxLocals;
+        uint32_t codeOffset, codeLength;
+        uint16_t linesName, linesCount;
+        uint32_t linesOffset;
+        uint16_t variablesName, variablesCount;
+        uint32_t variablesOffset;
+    };
+
+    struct Source
+    {
+        std::string path;
+        std::vector<uint8_t> bytes;
+        uint64_t size = 0;
+        int64_t time = 0;
+    };
+
+    static const uint8_t *base;
+    static size_t mappedLength;
+    static const Entry *entries;
+    static uint32_t count;
+    static const StringEntry *strings;
+    static uint32_t stringCount;
+    /* Interned on first use, guarded by lock */
+    static std::vector<Symbol *> symbols;
+
+    static std::mutex lock;
+    static std::map<std::string, Source> recorded;
+
+    static bool sourceInfo(const std::string &sourcePath,
+            uint64_t &size, int64_t &time);
+    static int compare(const Entry &entry, const std::string &className);
+    static const Entry *lookup(const std::string &className);
+    static bool valid(const Entry &entry);
+    static Symbol *symbol(uint32_t index);
+
+    static bool flatten(ClassFile &cf, std::vector<uint8_t> &data,
+            std::map<std::string, uint32_t> &stringIndex,
+            std::vector<std::string> &stringList);
+};
+
+#endif /* SHARED_ARCHIVE_H */
@@ -0,0 +1,37 @@
+#ifndef STACK_ARENA_H
+#define STACK_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Bump allocator for objects that live no longer than their frame */
+class StackArena
+{
+public:
+    struct Mark
+    {
+        size_t chunk = 0, offset = 0;
+    };
+
+    ~StackArena();
+
+    /* Memory returned is zeroed */
+    uint8_t *allocate(size_t size);
+    Mark mark();
+    void release(Mark m);
+
+private:
+    struct Chunk
+    {
+        uint8_t *data;
+        size_t size;
+    };
+
+    static const size_t chunkSize = 64 * 1024;
+
+    std::vector<Chunk> chunks;
+    size_t current = 0, offset = 0;
+};
+
+#endif /* STACK_ARENA_H */
@@ -0,0 +1,28 @@
+#ifndef STRINGS_H
+#define STRINGS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Object;
+
+/* java.lang.String objects, characters are kept in a char[] value field */
+class Strings
+{
+public:
+    static Object *create(const std::string &utf8);
+    /* String[] holding a new String for each item */
+    static Object *createArray(const std::vector<std::string> &items);
+    /* "null" for a null reference */
+    static std::string toUtf8(Object *str);
+    /* Appends one UTF-16 char, as toUtf8 encodes it */
+    static void appendUtf8(std::string &utf8, uint16_t c);
+    static int32_t length(Object *str);
+    static uint16_t *chars(Object *str);
+
+private:
+    static Object *&valueOf(Object *str);
+};
+
+#endif /* STRINGS_H */
@@ -0,0 +1,44 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Isolate;
+struct Method;
+struct Object;
+class Thread;
+
+/* Native threads or scheduler tasks backing java.lang.Thread objects */
+class ThreadManager
+{
+public:
+    static void start(Object *threadObject);
+    /* Green callers are marked blocked and parked instead of waiting */
+    static void join(Thread *caller, Object *threadObject);
+    /* Called by the scheduler when a task ends */
+    static void finished(Object *threadObject);
+    /* Waits for every started thread, used at VM exit */
+    static void joinAll();
+
+private:
+    struct NativeThread
+    {
+        std::thread thread;
+        bool done = false;
+        /* Green threads parked in join */
+        std::vector<Thread *> joiners;
+    };
+
+    static std::mutex lock;
+    static std::condition_variable doneCond;
+    static std::map<Object *, NativeThread> threads;
+
+    static Method *runMethod(Object *threadObject);
+    static void run(Object *threadObject, Isolate *isolate);
+};
+
+#endif /* THREADS_H */
@@ -0,0 +1,32 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <string>
+#include <vector>
+
+/*
+ * Fork server: classes are loaded and initialized once, then every
+ * request on a Unix socket is run in a forked child which shares the
+ * warmed runtime copy-on-write. Output and exit status of the child go
+ * to the client.
+ */
+class Zygote
+{
+public:
+    /* Returns only in a child, with the requested class and arguments */
+    static bool serve(const std::string &socketPath,
+            std::string &className, std::vector<std::string> &args);
+    /* Client side, copies the output of the run to stdout and stderr and
+     * sets status to its exit status */
+    static bool request(const std::string &socketPath,
+            const std::string &className, const std::vector<std::string> &args,
+            int &status);
+
+private:
+    static int listenSocket;
+
+    static bool readRequest(int fd, std::string &className,
+            std::vector<std::string> &args);
+};
+
+#endif /* ZYGOTE_H */
@@ -0,0 +1,252 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <class/java_class_builder.h>
+#include <jvm/jvm.h>
+#include <jvm/array_ops.h>
+#include <jvm/embed.h>
+
+/*
+ * Times System.arraycopy and the java.util.Arrays intrinsics on int[]
+ * against the same operations written as interpreted loops, once for
+ * every vector level this CPU supports.
+ */
+
+static const int32_t DEFAULT_LENGTH = 4096;
+static const int DEFAULT_REPEATS = 2000;
+static const char *BENCH_CLASS = "ArrayBench";
+
+/* for (i = 0; i < n; i++) body, i is in local index */
+template<typename Body>
+static void loop(MethodBuilder *mb, uint16_t n, uint16_t index, Body body)
+{
+    Label *head = new Label, *end = new Label;
+    mb->loadInteger(0);
+    mb->local(opcodes::ISTORE, index);
+    mb->insertLabel(head);
+    mb->local(opcodes::ILOAD, index);
+    mb->local(opcodes::ILOAD, n);
+    mb->jump(opcodes::IF_ICMPGE, end);
+    body();
+    mb->local(opcodes::IINC, index);
+    mb->instruction(1);
+    mb->jump(opcodes::GOTO, head);
+    mb->insertLabel(end);
+}
+
+static MethodBuilder *staticMethod(ClassBuilder &cb, const std::string &name,
+        const std::string &descriptor, uint16_t maxStack, uint16_t maxLocals)
+{
+    MethodBuilder *mb = cb.createMethod(name);
+    mb->setDescriptor(descriptor);
+    mb->setAccessFlags(ACC_PUBLIC | ACC_STATIC);
+    mb->setMax(maxStack, maxLocals);
+    return mb;
+}
+
+static ClassFile *benchClass()
+{
+    ClassBuilder cb(BENCH_CLASS);
+
+    /* loopFill(a, n, value) */
+    MethodBuilder *mb = staticMethod(cb, "loopFill", "([III)V", 3, 4);
+    loop(mb, 1, 3, [&] {
+        mb->local(opcodes::ALOAD, 0);
+        mb->local(opcodes::ILOAD, 3);
+        mb->local(opcodes::ILOAD, 2);
+        mb->instruction(opcodes::IASTORE);
+    });
+    mb->instruction(opcodes::RETURN);
+
+    /* loopCopy(src, dst, n) */
+    mb = staticMethod(cb, "loopCopy", "([I[II)V", 4, 4);
+    loop(mb, 2, 3, [&] {
+        mb->local(opcodes::ALOAD, 1);
+        mb->local(opcodes::ILOAD, 3);
+        mb->local(opcodes::ALOAD, 0);
+        mb->local(opcodes::ILOAD, 3);
+        mb->instruction(opcodes::IALOAD);
+        mb->instruction(opcodes::IASTORE);
+    });
+    mb->instruction(opcodes::RETURN);
+
+    /* loopEquals(a, b, n), lengths are equal */
+    mb = staticMethod(cb, "loopEquals", "([I[II)Z", 4, 4);
+    Label *differs = new Label;
+    loop(mb, 2, 3, [&] {
+        mb->local(opcodes::ALOAD, 0);
+        mb->local(opcodes::ILOAD, 3);
+        mb->instruction(opcodes::IALOAD);
+        mb->local(opcodes::ALOAD, 1);
+        mb->local(opcodes::ILOAD, 3);
+        mb->instruction(opcodes::IALOAD);
+        mb->instruction(opcodes::ISUB);
+        mb->jump(opcodes::IFNE, differs);
+    });
+    mb->loadInteger(1);
+    mb->instruction(opcodes::IRETURN);
+    mb->insertLabel(differs);
+    mb->loadInteger(0);
+    mb->instruction(opcodes::IRETURN);
+
+    /* loopHash(a, n) */
+    mb = staticMethod(cb, "loopHash", "([II)I", 3, 4);
+    mb->loadInteger(1);
+    mb->local(opcodes::ISTORE, 2);
+    loop(mb, 1, 3, [&] {
+        mb->loadInteger(31);
+        mb->local(opcodes::ILOAD, 2);
+        mb->instruction(opcodes::IMUL);
+        mb->local(opcodes::ALOAD, 0);
+        mb->local(opcodes::ILOAD, 3);
+        mb->instruction(opcodes::IALOAD);
+        mb->instruction(opcodes::IADD);
+        mb->local(opcodes::ISTORE, 2);
+    });
+    mb->local(opcodes::ILOAD, 2);
+    mb->instruction(opcodes::IRETURN);
+
+    /* Intrinsics are called from bytecode too, as programs call them */
+    mb = staticMethod(cb, "fill", "([II)V", 2, 2);
+    mb->local(opcodes::ALOAD, 0);
+    mb->local(opcodes::ILOAD, 1);
+    mb->invoke(opcodes::INVOKESTATIC, "java/util/Arrays", "fill", "([II)V");
+    mb->instruction(opcodes::RETURN);
+
+    mb = staticMethod(cb, "copy", "([I[II)V", 5, 3);
+    mb->local(opcodes::ALOAD, 0);
+    mb->loadInteger(0);
+    mb->local(opcodes::ALOAD, 1);
+    mb->loadInteger(0);
+    mb->local(opcodes::ILOAD, 2);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/System", "arraycopy",
+            "(Ljava/lang/Object;ILjava/lang/Object;II)V");
+    mb->instruction(opcodes::RETURN);
+
+    mb = staticMethod(cb, "equals", "([I[I)Z", 2, 2);
+    mb->local(opcodes::ALOAD, 0);
+    mb->local(opcodes::ALOAD, 1);
+    mb->invoke(opcodes::INVOKESTATIC, "java/util/Arrays", "equals", "([I[I)Z");
+    mb->instruction(opcodes::IRETURN);
+
+    mb = staticMethod(cb, "hash", "([I)I", 1, 1);
+    mb->local(opcodes::ALOAD, 0);
+    mb->invoke(opcodes::INVOKESTATIC, "java/util/Arrays", "hashCode", "([I)I");
+    mb->instruction(opcodes::IRETURN);
+
+    mb = staticMethod(cb, "sort", "([I)V", 1, 1);
+    mb->local(opcodes::ALOAD, 0);
+    mb->invoke(opcodes::INVOKESTATIC, "java/util/Arrays", "sort", "([I)V");
+    mb->instruction(opcodes::RETURN);
+
+    return cb.build();
+}
+
+static MethodHandle handle(const std::string &name,
+        const std::string &descriptor)
+{
+    return MethodHandle::find(BENCH_CLASS, name, descriptor);
+}
+
+/* Nanoseconds per element */
+template<typename Run>
+static double measure(int repeats, int32_t length, Run run)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        run();
+    std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repeats / length;
+}
+
+static void report(const std::string &name, double interpreted,
+        const std::vector<double> &intrinsic)
+{
+    std::cout << name << "\t" << interpreted;
+    for (double time : intrinsic)
+        std::cout << "\t" << time << " (" << interpreted / time << "x)";
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int32_t length = argc > 1 ? std::stoi(argv[1]) : DEFAULT_LENGTH;
+    int repeats = argc > 2 ? std::stoi(argv[2]) : DEFAULT_REPEATS;
+    if (length <= 0 || repeats <= 0) {
+        std::cerr << "Usage: array_bench [length] [repeats]" << std::endl;
+        return 1;
+    }
+
+    ClassLoader::defineClass(benchClass());
+    CallContext &context = CallContext::current();
+
+    ArrayClass *intArray = static_cast<ArrayClass *>(ClassCache::getClass("[I"));
+    Object *a = intArray->newArray(length), *b = intArray->newArray(length);
+    for (int32_t i = 0; i < length; i++)
+        ArrayOps::items<int32_t>(a)[i] = i * 7919 - length;
+
+    MethodHandle loopFill = handle("loopFill", "([III)V");
+    MethodHandle loopCopy = handle("loopCopy", "([I[II)V");
+    MethodHandle loopEquals = handle("loopEquals", "([I[II)Z");
+    MethodHandle loopHash = handle("loopHash", "([II)I");
+    MethodHandle fill = handle("fill", "([II)V");
+    MethodHandle copy = handle("copy", "([I[II)V");
+    MethodHandle equals = handle("equals", "([I[I)Z");
+    MethodHandle hash = handle("hash", "([I)I");
+    MethodHandle sort = handle("sort", "([I)V");
+
+    std::vector<ArrayOps::Level> levels;
+    for (int level = ArrayOps::SCALAR; level <= ArrayOps::supported; level++)
+        levels.push_back(static_cast<ArrayOps::Level>(level));
+
+    std::cout << "int[" << length << "], " << repeats
+              << " repeats, ns per element" << std::endl
+              << "op\tinterpreted";
+    for (ArrayOps::Level level : levels)
+        std::cout << "\t" << ArrayOps::levelName(level);
+    std::cout << std::endl;
+
+    /* Results of every level are checked against the interpreted loops */
+    int32_t expectedHash = context.callInt(loopHash, a, length);
+    bool failed = false;
+    std::vector<double> fillTimes, equalsTimes, hashTimes;
+    for (ArrayOps::Level level : levels) {
+        ArrayOps::limit(level);
+        fillTimes.push_back(measure(repeats, length,
+                [&] { context.callVoid(fill, b, 42); }));
+        context.callVoid(copy, a, b, length);
+        equalsTimes.push_back(measure(repeats, length,
+                [&] { context.callBoolean(equals, a, b); }));
+        hashTimes.push_back(measure(repeats, length,
+                [&] { context.callInt(hash, a); }));
+        failed |= !context.callBoolean(equals, a, b) ||
+                context.callInt(hash, a) != expectedHash;
+    }
+
+    report("fill", measure(repeats, length,
+            [&] { context.callVoid(loopFill, b, length, 42); }), fillTimes);
+    /* Copy is memmove at every level, timed once */
+    report("copy", measure(repeats, length,
+            [&] { context.callVoid(loopCopy, a, b, length); }),
+            {measure(repeats, length,
+                [&] { context.callVoid(copy, a, b, length); })});
+    report("equals", measure(repeats, length,
+            [&] { context.callBoolean(loopEquals, a, b, length); }), equalsTimes);
+    report("hash", measure(repeats, length,
+            [&] { context.callInt(loopHash, a, length); }), hashTimes);
+
+    /* Sorting has no vector code; timed once, as it leaves a sorted */
+    double sortTime = measure(1, length, [&] { context.callVoid(sort, a); });
+    std::cout << "sort\t-\t" << sortTime << std::endl;
+    for (int32_t i = 1; i < length; i++)
+        failed |= ArrayOps::items<int32_t>(a)[i - 1] > ArrayOps::items<int32_t>(a)[i];
+
+    if (failed) {
+        std::cerr << "Intrinsic results differ from interpreted loops" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -15,6 +15,11 @@ ClassFile ClassFile::read(ByteReader *bs)
     for (int i = 1; i < cf.constantPoolCount; i++) {
         ci = ConstantPoolInfo::read(bs);
         cf.constantPool.push_back(ci);
+        /* Longs and doubles take two entries */
+        if (ci->tag == CONSTANT_Long || ci->tag == CONSTANT_Double) {
+            cf.constantPool.push_back(new UnusableInfo);
+            i++;
+        }
     }
 
     cf.accessFlags = bs->read16();
@@ -74,6 +79,8 @@ void ClassFile::write(ByteWriter* bs)
 
 std::string ClassFile::getUtf8(uint16_t index)
 {
+    if (index == 0 || index > constantPool.size())
+        return "";
     ConstantPoolInfo *ci = constantPool[index - 1];
     if (ci->tag == CONSTANT_Utf8) {
         Utf8Info *utf8 = (Utf8Info *) ci;
@@ -82,6 +89,18 @@ std::string ClassFile::getUtf8(uint16_t index)
     return "";
 }
 
+Symbol *ClassFile::getSymbol(uint16_t index)
+{
+    ConstantPoolInfo *ci = constantPool[index - 1];
+    if (ci->tag != CONSTANT_Utf8)
+        return nullptr;
+
+    Utf8Info *utf8 = static_cast<Utf8Info *>(ci);
+    if (utf8->symbol == nullptr)
+        return Symbol::intern(utf8->str);
+    return utf8->symbol;
+}
+
 std::string ClassFile::getIndexName(uint16_t index)
 {
     ConstantPoolInfo *constInfo = constantPool[index - 1];
@@ -113,12 +132,19 @@ ConstantPoolInfo *ConstantPoolInfo::read(ByteReader *bs)
             ci = IndexInfo::read(bs);
             break;
         case CONSTANT_Integer:
+        case CONSTANT_Float:
             ci = Const32Info::read(bs);
             break;
+        case CONSTANT_Long:
+        case CONSTANT_Double:
+            ci = Const64Info::read(bs);
+            break;
         case CONSTANT_Utf8:
             ci = Utf8Info::read(bs);
             break;
         default:
+            /* Unsupported or invalid, kept so that indices stay right */
+            ci = new ConstantPoolInfo;
             break;
     }
 
@@ -169,6 +195,22 @@ Const32Info *Const32Info::read(ByteReader *bs)
     return ri;
 }
 
+Const64Info *Const64Info::read(ByteReader *bs)
+{
+    Const64Info *ri = new Const64Info;
+
+    uint64_t high = bs->read32();
+    ri->value = high << 32 | bs->read32();
+    return ri;
+}
+
+void Const64Info::write(ByteWriter *bs)
+{
+    ConstantPoolInfo::write(bs);
+    bs->write((uint32_t) (value >> 32));
+    bs->write((uint32_t) value);
+}
+
 void IndexInfo::write(ByteWriter *bs)
 {
     ConstantPoolInfo::write(bs);
@@ -184,6 +226,8 @@ Utf8Info *Utf8Info::read(ByteReader *bs)
     bs->read(str, len);
     str[len] = 0;
     utf8->str = std::string((char *) str);
+    utf8->symbol = Symbol::intern(utf8->str);
+    delete[] str;
     return utf8;
 }
 
@@ -13,6 +13,23 @@ MethodBuilder *ClassBuilder::createMethod(std::string name)
     return mb;
 }
 
+void ClassBuilder::setSuper(std::string superName)
+{
+    this->superName = superName;
+}
+
+void ClassBuilder::addField(std::string name, std::string descriptor,
+        uint16_t flags)
+{
+    MemberInfo *fieldInfo = new MemberInfo;
+
+    fieldInfo->accessFlags = flags;
+    fieldInfo->nameIndex = addUtf8(name);
+    fieldInfo->descriptorIndex = addUtf8(descriptor);
+    fieldInfo->attributesCount = 0;
+    fields.push_back(fieldInfo);
+}
+
 uint16_t ClassBuilder::addNewItem(ConstantPoolInfo *ci)
 {
     constantPool.push_back(ci);
@@ -29,6 +46,7 @@ uint16_t ClassBuilder::addUtf8(std::string str)
     // TODO Set tag in constructor
     utf8->tag = CONSTANT_Utf8;
     utf8->str = str;
+    utf8->symbol = Symbol::intern(str);
     uint16_t ref = addNewItem(utf8);
     utf8Index[str] = ref;
     return ref;
@@ -75,6 +93,17 @@ uint16_t ClassBuilder::addInteger(int32_t integer)
     return addNewItem(intInf);
 }
 
+uint16_t ClassBuilder::addLong(int64_t value)
+{
+    Const64Info *longInf = new Const64Info;
+
+    longInf->tag = CONSTANT_Long;
+    longInf->value = value;
+    uint16_t ref = addNewItem(longInf);
+    addNewItem(new UnusableInfo);
+    return ref;
+}
+
 // TODO Refactor code duplication
 
 uint16_t ClassBuilder::addFieldRef(
@@ -119,14 +148,15 @@ ClassFile* ClassBuilder::build()
     classFile->majorVersion = 52;
 
     classFile->interfacesCount = 0;
-    classFile->fieldsCount = 0;
+    classFile->fieldsCount = fields.size();
+    classFile->fields = fields;
     classFile->attributesCount = 0;
 
     classFile->methodsCount = methodBuilders.size();
     for (uint16_t i = 0; i < methodBuilders.size(); i++)
         classFile->methods.push_back(methodBuilders[i]->build());
     classFile->thisClass = addClass(name);
-    classFile->superClass = addClass("java/lang/Object");
+    classFile->superClass = superName.empty() ? 0 : addClass(superName);
 
     classFile->accessFlags = ACC_SUPER;
 
@@ -225,6 +255,16 @@ void MethodBuilder::loadInteger(int32_t integer)
     }
 }
 
+void MethodBuilder::loadLong(int64_t value)
+{
+    if (value == 0 || value == 1) {
+        instruction(opcodes::LCONST_0 + value);
+    } else {
+        codeWriter->write(opcodes::LDC2_W);
+        codeWriter->write(cb->addLong(value));
+    }
+}
+
 void MethodBuilder::loadRef(uint16_t ref)
 {
     if (ref < 256) {
@@ -252,13 +292,20 @@ void MethodBuilder::field(uint8_t opCode, std::string className,
     codeWriter->write(ref);
 }
 
+void MethodBuilder::type(uint8_t opCode, std::string className)
+{
+    uint16_t ref = cb->addClass(className);
+    codeWriter->write(opCode);
+    codeWriter->write(ref);
+}
+
 void MethodBuilder::setMax(uint16_t maxStack, uint16_t maxLocals)
 {
     this->maxStack = maxStack;
     this->maxLocals = maxLocals;
 }
 
-void MethodBuilder::frame(Frame *frame)
+void MethodBuilder::frame(CodeFrame *frame)
 {
     frame->ref = codeBuilder->written;
     frames.push_back(frame);
@@ -266,14 +313,14 @@ void MethodBuilder::frame(Frame *frame)
 
 void MethodBuilder::frameSame()
 {
-    Frame *f = new Frame;
+    CodeFrame *f = new CodeFrame;
     f->frameTag = same_frame;
     frame(f);
 }
 
 void MethodBuilder::frameAppend(std::vector<FrameType> &types)
 {
-    Frame *f = new Frame;
+    CodeFrame *f = new CodeFrame;
     f->frameTag = append_frame;
     /* types size must be in range 1..3 */
     f->locals = types;
@@ -296,6 +343,12 @@ void MethodBuilder::local(uint8_t opCode, uint16_t index)
             case opcodes::ASTORE:
                 instruction(opcodes::ASTORE_0 + index);
                 return;
+            case opcodes::LLOAD:
+                instruction(opcodes::LLOAD_0 + index);
+                return;
+            case opcodes::LSTORE:
+                instruction(opcodes::LSTORE_0 + index);
+                return;
             default:
                 break;
         }
@@ -308,6 +361,16 @@ void MethodBuilder::local(uint8_t opCode, uint16_t index)
 
 MemberInfo *MethodBuilder::build()
 {
+    /* Native and abstract methods have no code */
+    if (accessFlags & (ACC_NATIVE | ACC_ABSTRACT)) {
+        MemberInfo *methodInfo = new MemberInfo;
+        methodInfo->accessFlags = accessFlags;
+        methodInfo->nameIndex = cb->addUtf8(name);
+        methodInfo->descriptorIndex = cb->addUtf8(descriptor);
+        methodInfo->attributesCount = 0;
+        return methodInfo;
+    }
+
     for (size_t i = 0; i < labels.size(); i++)
         labels[i]->setJumps(codeBuilder);
 
@@ -3,30 +3,30 @@
 const std::string opcodes::names[] = {
     ""        , ""        , "iconst_m1", "iconst_0",
     "iconst_1", "iconst_2", "iconst_3", "iconst_4",
-    "iconst_5", ""        , ""        , ""        ,
+    "iconst_5", "lconst_0", "lconst_1", ""        ,
     ""        , ""        , ""        , ""        ,
     "bipush"  , "sipush"  , "ldc"     , "ldc_w"   ,
-    "ldc2_w"  , "iload"   , ""        , ""        ,
+    "ldc2_w"  , "iload"   , "lload"   , ""        ,
     ""        , "aload"   , "iload_0" , "iload_1" ,
-    "iload_2" , "iload_3" , ""        , ""        ,
-    ""        , ""        , ""        , ""        ,
+    "iload_2" , "iload_3" , "lload_0" , "lload_1" ,
+    "lload_2" , "lload_3" , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
     ""        , ""        , "aload_0" , "aload_1" ,
     "aload_2" , "aload_3" , "iaload"  , ""        ,
     ""        , ""        , ""        , "baload"  ,
-    ""        , ""        , "istore"  , ""        ,
+    ""        , ""        , "istore"  , "lstore"  ,
     ""        , ""        , "astore"  , "istore_0",
-    "istore_1", "istore_2", "istore_3", ""        ,
-    ""        , ""        , ""        , ""        ,
+    "istore_1", "istore_2", "istore_3", "lstore_0",
+    "lstore_1", "lstore_2", "lstore_3", ""        ,
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , "astore_0",
     "astore_1", "astore_2", "astore_3", "iastore" ,
     ""        , ""        , ""        , ""        ,
     "bastore" , ""        , ""        , "pop"     ,
-    ""        , "dup"     , "dup_x1"  , ""        ,
+    "pop2"    , "dup"     , "dup_x1"  , ""        ,
     ""        , ""        , ""        , ""        ,
-    "iadd"    , ""        , ""        , ""        ,
-    "isub"    , ""        , ""        , ""        ,
+    "iadd"    , "ladd"    , ""        , ""        ,
+    "isub"    , "lsub"    , ""        , ""        ,
     "imul"    , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
@@ -34,22 +34,22 @@ const std::string opcodes::names[] = {
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
-    "iinc"    , ""        , ""        , ""        ,
-    ""        , ""        , ""        , ""        ,
+    "iinc"    , "i2l"     , ""        , ""        ,
+    "l2i"     , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
-    ""        , ""        , ""        , ""        ,
-    ""        , "ifeq"    , "ifne"    , ""        ,
-    ""        , ""        , ""        , ""        ,
+    "lcmp"    , ""        , ""        , ""        ,
+    ""        , "ifeq"    , "ifne"    , "iflt"    ,
+    "ifge"    , "ifgt"    , "ifle"    , ""        ,
     ""        , "if_icmplt", "if_icmpge", ""        ,
     "if_icmple", ""        , ""        , "goto"    ,
     ""        , ""        , ""        , ""        ,
-    "ireturn" , ""        , ""        , ""        ,
+    "ireturn" , "lreturn" , ""        , ""        ,
     "areturn" , "return"  , "getstatic", "putstatic",
     "getfield", "putfield", "invokevirtual", "invokespecial",
     "invokestatic", ""        , ""        , "new"     ,
     "newarray", ""        , ""        , ""        ,
-    ""        , ""        , ""        , ""        ,
+    ""        , ""        , "monitorenter", "monitorexit",
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
     ""        , ""        , ""        , ""        ,
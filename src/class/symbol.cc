@@ -0,0 +1,24 @@
+#include <class/symbol.h>
+
+std::mutex Symbol::lock;
+
+std::unordered_map<std::string, Symbol *> &Symbol::table()
+{
+    /* Constructed on first use, classes may be parsed during static init */
+    static std::unordered_map<std::string, Symbol *> symbols;
+    return symbols;
+}
+
+Symbol *Symbol::intern(const std::string &str)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    std::unordered_map<std::string, Symbol *> &symbols = table();
+    auto findIterator = symbols.find(str);
+    if (findIterator != symbols.end())
+        return findIterator->second;
+
+    Symbol *symbol = new Symbol(str);
+    symbols[str] = symbol;
+    return symbol;
+}
@@ -0,0 +1,23 @@
+#include <algorithm>
+#include <cstring>
+
+#include <io/memory_byte_reader.h>
+
+MemoryByteReader::MemoryByteReader(const uint8_t *data, size_t length) :
+    data(data), length(length), position(0), pastEnd(false)
+{
+}
+
+MemoryByteReader::~MemoryByteReader()
+{
+}
+
+void MemoryByteReader::read(uint8_t *buffer, size_t count)
+{
+    size_t available = std::min(count, length - position);
+
+    memcpy(buffer, data + position, available);
+    std::fill(buffer + available, buffer + count, 0);
+    position += available;
+    pastEnd |= available < count;
+}
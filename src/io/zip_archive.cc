@@ -0,0 +1,197 @@
+#include <config.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <io/zip_archive.h>
+
+static const uint32_t
+    LOCAL_HEADER_SIGNATURE   = 0x04034b50,
+    CENTRAL_HEADER_SIGNATURE = 0x02014b50,
+    END_SIGNATURE            = 0x06054b50;
+
+static const size_t
+    LOCAL_HEADER_SIZE   = 30,
+    CENTRAL_HEADER_SIZE = 46,
+    END_SIZE            = 22,
+    /* End record may be followed by a comment of up to 64 KiB */
+    END_SEARCH_LIMIT    = END_SIZE + 0xFFFF;
+
+static const uint16_t
+    METHOD_STORED   = 0,
+    METHOD_DEFLATED = 8;
+
+/* ZIP fields are little-endian */
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t) p[0] | (uint16_t) p[1] << 8;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+           (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+ZipArchive *ZipArchive::open(const std::string &path)
+{
+    ZipArchive *archive = new ZipArchive;
+
+#ifdef HAVE_SYS_MMAN_H
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED) {
+                archive->data = static_cast<const uint8_t *>(mapping);
+                archive->length = st.st_size;
+                archive->mapped = true;
+            }
+        }
+        close(fd);
+    }
+#else
+    std::ifstream f(path.c_str(), std::ifstream::binary);
+    std::vector<char> contents((std::istreambuf_iterator<char>(f)),
+            std::istreambuf_iterator<char>());
+    if (!contents.empty()) {
+        uint8_t *copy = new uint8_t[contents.size()];
+        memcpy(copy, contents.data(), contents.size());
+        archive->data = copy;
+        archive->length = contents.size();
+    }
+#endif
+
+    if (archive->data == nullptr || !archive->index()) {
+        delete archive;
+        return nullptr;
+    }
+    return archive;
+}
+
+ZipArchive::~ZipArchive()
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (mapped)
+        munmap(const_cast<uint8_t *>(data), length);
+#endif
+    if (!mapped)
+        delete[] data;
+}
+
+bool ZipArchive::index()
+{
+    if (length < END_SIZE)
+        return false;
+
+    size_t searchEnd = length > END_SEARCH_LIMIT ? length - END_SEARCH_LIMIT : 0;
+    const uint8_t *end = nullptr;
+    for (size_t i = length - END_SIZE + 1; i-- > searchEnd; ) {
+        if (le32(data + i) == END_SIGNATURE) {
+            end = data + i;
+            break;
+        }
+    }
+    if (end == nullptr)
+        return false;
+
+    uint16_t count = le16(end + 10);
+    uint32_t directorySize = le32(end + 12);
+    uint32_t directoryOffset = le32(end + 16);
+    if ((uint64_t) directoryOffset + directorySize > length)
+        return false;
+
+    items.reserve(count);
+    const uint8_t *p = data + directoryOffset;
+    const uint8_t *directoryEnd = p + directorySize;
+    for (uint16_t i = 0; i < count; i++) {
+        if (p + CENTRAL_HEADER_SIZE > directoryEnd ||
+                le32(p) != CENTRAL_HEADER_SIGNATURE)
+            return false;
+
+        uint16_t nameLength = le16(p + 28);
+        uint16_t extraLength = le16(p + 30);
+        uint16_t commentLength = le16(p + 32);
+        if (p + CENTRAL_HEADER_SIZE + nameLength > directoryEnd)
+            return false;
+
+        Item item;
+        item.method = le16(p + 10);
+        item.compressedSize = le32(p + 20);
+        item.size = le32(p + 24);
+        item.localOffset = le32(p + 42);
+        items.emplace(std::string(reinterpret_cast<const char *>(p + CENTRAL_HEADER_SIZE),
+                nameLength), item);
+
+        p += CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+bool ZipArchive::contains(const std::string &name) const
+{
+    return items.find(name) != items.end();
+}
+
+const uint8_t *ZipArchive::read(const std::string &name, size_t &size,
+        std::vector<uint8_t> &buffer) const
+{
+    auto found = items.find(name);
+    if (found == items.end())
+        return nullptr;
+    const Item &item = found->second;
+
+    /* Local header may have its own extra field */
+    if ((uint64_t) item.localOffset + LOCAL_HEADER_SIZE > length)
+        return nullptr;
+    const uint8_t *local = data + item.localOffset;
+    if (le32(local) != LOCAL_HEADER_SIGNATURE)
+        return nullptr;
+    uint64_t dataOffset = (uint64_t) item.localOffset + LOCAL_HEADER_SIZE +
+            le16(local + 26) + le16(local + 28);
+    if (dataOffset + item.compressedSize > length)
+        return nullptr;
+    const uint8_t *compressed = data + dataOffset;
+
+    if (item.method == METHOD_STORED) {
+        size = item.compressedSize;
+        return compressed;
+    }
+
+#ifdef HAVE_ZLIB
+    if (item.method == METHOD_DEFLATED) {
+        buffer.resize(item.size);
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        /* Negative window bits: raw deflate data, no zlib header */
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+            return nullptr;
+        stream.next_in = const_cast<Bytef *>(compressed);
+        stream.avail_in = item.compressedSize;
+        stream.next_out = buffer.data();
+        stream.avail_out = item.size;
+        int status = inflate(&stream, Z_FINISH);
+        inflateEnd(&stream);
+
+        if (status != Z_STREAM_END || stream.total_out != item.size)
+            return nullptr;
+        size = item.size;
+        return buffer.data();
+    }
+#endif
+
+    return nullptr;
+}
@@ -1,21 +1,270 @@
+#include <iostream>
+#include <cstring>
+#include <thread>
+
 #include <io/file_byte_reader.h>
 #include <class/java_class.h>
 #include <jvm/jvm.h>
+#include <jvm/alloc_profiler.h>
+#include <jvm/class_path.h>
+#include <jvm/cpu_profiler.h>
+#include <jvm/heap_snapshot.h>
+#include <jvm/isolate.h>
+#include <jvm/prefetcher.h>
+#include <jvm/exec_counters.h>
+#include <jvm/safepoint.h>
+#include <jvm/scheduler.h>
+#include <jvm/shared_archive.h>
+#include <jvm/strings.h>
+#include <jvm/threads.h>
+#include <jvm/zygote.h>
 
-int main(int argc, char *argv[])
+static const uint32_t DEFAULT_ALLOC_SAMPLE_BYTES = 512 * 1024;
+static const uint32_t DEFAULT_SAFEPOINT_INTERVAL = 100;
+static const uint32_t CPU_PROFILE_HZ = 1000;
+static const unsigned DEFAULT_PREFETCH_THREADS = 2;
+static const char *DEFAULT_CPU_PROFILE = "java.collapsed";
+static const char *DEFAULT_SHARED_ARCHIVE = "java.jsa";
+static const char *DEFAULT_HEAP_SNAPSHOT = "java.heap";
+
+static void usage()
 {
-    std::string classPath = argv[1];
+    std::cerr << "Usage: java [options] <class> [args...]" << std::endl
+              << "       java -Xzygote:<socket> [options] [<class>...]" << std::endl
+              << "Options:" << std::endl
+              << "  -cp <path>              search <path> for classes, directories and .jar/.zip" << std::endl
+              << "                          archives separated by ':'" << std::endl
+              << "  -Xprefetch[:<threads>]  load classes referenced by loaded ones in the background" << std::endl
+              << "  -Xtrace                 dump call stack on every instruction" << std::endl
+              << "  -Xallocprof[:<bytes>]   sample one allocation per <bytes> allocated" << std::endl
+              << "  -Xgreen[:<workers>]     run Java threads on a pool of <workers> native threads" << std::endl
+              << "  -Xsafepoint[:<ms>]      stop all threads every <ms> and report time to safepoint" << std::endl
+              << "  -Xprof[:<file>]         sample stacks at 1 kHz, write collapsed stacks to <file>" << std::endl
+              << "  -Xcount                 count executed opcodes, opcode pairs and methods" << std::endl
+              << "  -Xshare[:<file>]        load classes from a shared archive if it is up to date" << std::endl
+              << "  -Xsharedump[:<file>]    write the classes loaded by this run to a shared archive" << std::endl
+              << "  -Xsnapshot[:<file>]     initialize the main class, save the heap to <file> and exit" << std::endl
+              << "  -Xrestore[:<file>]      restore a heap saved by -Xsnapshot before running main" << std::endl
+              << "  -Xisolates:<n>          run <n> copies of the program side by side, statics not shared" << std::endl
+              << "  -Xzygote:<socket>       initialize <class>... and fork a run for every request on <socket>" << std::endl
+              << "  -Xconnect:<socket>      run <class> in the zygote listening on <socket>" << std::endl;
+}
 
+static std::string classNameOf(const std::string &classPath)
+{
     size_t found = classPath.find_last_of('.');
-    std::string className = classPath.substr(0, found);
+    return classPath.substr(0, found);
+}
+
+/* Allocated as the thread running main, so its isolate is charged */
+static Object *mainArgs(Thread *thread, const std::vector<std::string> &args)
+{
+    Thread *previous = Thread::current;
+    Thread::current = thread;
+    Object *array = Strings::createArray(args);
+    Thread::current = previous;
+    return array;
+}
+
+int main(int argc, char *argv[])
+{
+    int argIndex = 1;
+    unsigned greenWorkers = 0;
+    unsigned isolateCount = 1;
+    unsigned prefetchThreads = 0;
+    uint32_t safepointInterval = 0;
+    std::string cpuProfile;
+    std::string sharedArchive, sharedDump;
+    std::string snapshot, restore;
+    std::string zygoteSocket, connectSocket;
+    for (; argIndex < argc && argv[argIndex][0] == '-'; argIndex++) {
+        std::string option = argv[argIndex];
+        if ((option == "-cp" || option == "-classpath") && argIndex + 1 < argc) {
+            ClassPath::set(argv[++argIndex]);
+        } else if (option.compare(0, 10, "-Xprefetch") == 0) {
+            prefetchThreads = DEFAULT_PREFETCH_THREADS;
+            if (option.length() > 11 && option[10] == ':')
+                prefetchThreads = std::stoul(option.substr(11));
+        } else if (option == "-Xtrace") {
+            Debug::trace = true;
+        } else if (option.compare(0, 11, "-Xallocprof") == 0) {
+            uint32_t sampleBytes = DEFAULT_ALLOC_SAMPLE_BYTES;
+            if (option.length() > 12 && option[11] == ':')
+                sampleBytes = std::stoul(option.substr(12));
+            AllocationProfiler::enable(sampleBytes);
+        } else if (option.compare(0, 7, "-Xgreen") == 0) {
+            greenWorkers = std::thread::hardware_concurrency();
+            if (option.length() > 8 && option[7] == ':')
+                greenWorkers = std::stoul(option.substr(8));
+            if (greenWorkers == 0)
+                greenWorkers = 1;
+        } else if (option.compare(0, 11, "-Xsafepoint") == 0) {
+            safepointInterval = DEFAULT_SAFEPOINT_INTERVAL;
+            if (option.length() > 12 && option[11] == ':')
+                safepointInterval = std::stoul(option.substr(12));
+        } else if (option == "-Xcount") {
+            ExecutionCounters::enable();
+        } else if (option.compare(0, 6, "-Xprof") == 0) {
+            cpuProfile = DEFAULT_CPU_PROFILE;
+            if (option.length() > 7 && option[6] == ':')
+                cpuProfile = option.substr(7);
+        } else if (option.compare(0, 11, "-Xsharedump") == 0) {
+            sharedDump = DEFAULT_SHARED_ARCHIVE;
+            if (option.length() > 12 && option[11] == ':')
+                sharedDump = option.substr(12);
+            SharedArchive::recording = true;
+        } else if (option.compare(0, 7, "-Xshare") == 0) {
+            sharedArchive = DEFAULT_SHARED_ARCHIVE;
+            if (option.length() > 8 && option[7] == ':')
+                sharedArchive = option.substr(8);
+        } else if (option.compare(0, 10, "-Xsnapshot") == 0) {
+            snapshot = DEFAULT_HEAP_SNAPSHOT;
+            if (option.length() > 11 && option[10] == ':')
+                snapshot = option.substr(11);
+        } else if (option.compare(0, 9, "-Xrestore") == 0) {
+            restore = DEFAULT_HEAP_SNAPSHOT;
+            if (option.length() > 10 && option[9] == ':')
+                restore = option.substr(10);
+        } else if (option.compare(0, 11, "-Xisolates:") == 0) {
+            isolateCount = std::stoul(option.substr(11));
+            if (isolateCount == 0)
+                isolateCount = 1;
+        } else if (option.compare(0, 9, "-Xzygote:") == 0) {
+            zygoteSocket = option.substr(9);
+        } else if (option.compare(0, 10, "-Xconnect:") == 0) {
+            connectSocket = option.substr(10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (argIndex >= argc && zygoteSocket.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::string className;
+    std::vector<std::string> args;
+    if (argIndex < argc) {
+        className = classNameOf(argv[argIndex]);
+        args.assign(argv + argIndex + 1, argv + argc);
+    }
+
+    if (!connectSocket.empty()) {
+        int status;
+        if (Zygote::request(connectSocket, className, args, status))
+            return status;
+        std::cerr << "Could not connect to zygote " << connectSocket << std::endl;
+        return 1;
+    }
+
+    if (!sharedArchive.empty() && sharedDump.empty() &&
+            !SharedArchive::open(sharedArchive))
+        std::cerr << "Shared archive " << sharedArchive
+                  << " is missing or invalid, loading class files" << std::endl;
+
+    if (prefetchThreads > 0)
+        Prefetcher::start(prefetchThreads);
+
+    if (!restore.empty() && !HeapSnapshot::restore(restore, Isolate::main()))
+        std::cerr << "Heap snapshot " << restore
+                  << " is missing, invalid or out of date, initializing classes" << std::endl;
+
+    if (!zygoteSocket.empty()) {
+        Thread th;
+        for (int i = argIndex; i < argc; i++)
+            th.initialize(ClassCache::getClass(classNameOf(argv[i])));
+        /* Fork copies only the calling thread */
+        ThreadManager::joinAll();
+        Prefetcher::stop();
+
+        args.clear();
+        if (!Zygote::serve(zygoteSocket, className, args)) {
+            std::cerr << "Could not listen on " << zygoteSocket << std::endl;
+            return 1;
+        }
+        if (prefetchThreads > 0)
+            Prefetcher::start(prefetchThreads);
+    }
 
     Class *cls = ClassCache::getClass(className);
     Method *mainMethod =
             cls->getMethod("main", "([Ljava/lang/String;)V");
 
-    Thread th;
-    th.prepareInit(cls);
-    th.invoke(mainMethod);
+    if (!snapshot.empty()) {
+        Thread th;
+        th.initialize(cls);
+        ThreadManager::joinAll();
+        Prefetcher::stop();
+
+        if (!sharedDump.empty() && !SharedArchive::dump(sharedDump))
+            std::cerr << "Could not write shared archive " << sharedDump << std::endl;
+        if (!HeapSnapshot::save(snapshot, Isolate::main())) {
+            std::cerr << "Could not write heap snapshot " << snapshot << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (safepointInterval > 0)
+        Safepoint::startPeriodic(safepointInterval);
+    if (!cpuProfile.empty() && !CpuProfiler::start(CPU_PROFILE_HZ, cpuProfile))
+        std::cerr << "CPU profiler is not supported on this platform" << std::endl;
+
+    /* The launcher runs in the main isolate, others get fresh statics */
+    std::vector<Isolate *> isolates(1, Isolate::main());
+    for (unsigned i = 1; i < isolateCount; i++)
+        isolates.push_back(new Isolate);
+
+    if (greenWorkers > 0) {
+        std::vector<Thread *> mainTasks;
+        for (Isolate *isolate : isolates) {
+            Thread *mainTask = new Thread(isolate);
+            mainTask->prepareInit(cls);
+            mainTask->prepare(mainMethod, {(intptr_t) mainArgs(mainTask, args)});
+            mainTasks.push_back(mainTask);
+        }
+        Scheduler::run(mainTasks, greenWorkers);
+    } else {
+        auto runMain = [&](Isolate *isolate) {
+            Thread th(isolate);
+            th.prepareInit(cls);
+            th.invoke(mainMethod, {(intptr_t) mainArgs(&th, args)});
+        };
+
+        std::vector<std::thread> runners;
+        for (size_t i = 1; i < isolates.size(); i++)
+            runners.push_back(std::thread(runMain, isolates[i]));
+        runMain(isolates[0]);
+        for (std::thread &runner : runners)
+            runner.join();
+
+        /* VM exits when all threads have finished */
+        ThreadManager::joinAll();
+    }
+
+    if (isolates.size() > 1)
+        for (Isolate *isolate : isolates)
+            std::cerr << "Isolate " << isolate->id << ": "
+                      << isolate->allocatedBytes << " bytes allocated" << std::endl;
+
+    CpuProfiler::stop();
+    Prefetcher::stop();
+
+    if (!sharedDump.empty() && !SharedArchive::dump(sharedDump))
+        std::cerr << "Could not write shared archive " << sharedDump << std::endl;
+
+    if (safepointInterval > 0) {
+        Safepoint::stopPeriodic();
+        Safepoint::report(std::cerr);
+    }
+
+    if (ExecutionCounters::enabled)
+        ExecutionCounters::report(std::cerr);
+
+    if (AllocationProfiler::enabled)
+        AllocationProfiler::report(std::cerr);
 
     return 0;
 }
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <jvm/jvm.h>
+#include <jvm/alloc_profiler.h>
+
+bool AllocationProfiler::enabled = false;
+uint32_t AllocationProfiler::sampleBytes = 0;
+thread_local uint64_t AllocationProfiler::bytesSinceSample = 0;
+
+std::mutex AllocationProfiler::statsLock;
+std::map<Class *, AllocationProfiler::Stats> AllocationProfiler::classStats;
+std::map<AllocationProfiler::Site, AllocationProfiler::Stats> AllocationProfiler::siteStats;
+
+bool AllocationProfiler::Site::operator<(const Site &other) const
+{
+    if (depth != other.depth)
+        return depth < other.depth;
+    for (int i = 0; i < depth; i++) {
+        if (methods[i] != other.methods[i])
+            return methods[i] < other.methods[i];
+        if (pcs[i] != other.pcs[i])
+            return pcs[i] < other.pcs[i];
+    }
+    return false;
+}
+
+void AllocationProfiler::Stats::add(uint64_t weight, uint32_t size)
+{
+    samples++;
+    bytes += weight;
+    count += static_cast<double>(weight) / size;
+}
+
+void AllocationProfiler::enable(uint32_t sampleBytes)
+{
+    AllocationProfiler::sampleBytes = sampleBytes;
+    enabled = true;
+}
+
+void AllocationProfiler::record(Class *cls, uint32_t size)
+{
+    bytesSinceSample += size;
+    if (bytesSinceSample >= sampleBytes)
+        sample(cls, size);
+}
+
+void AllocationProfiler::sample(Class *cls, uint32_t size)
+{
+    /* Sample stands for everything allocated since the previous one */
+    uint64_t weight = bytesSinceSample;
+    bytesSinceSample = 0;
+
+    Site site;
+    site.depth = 0;
+    Thread *thread = Thread::current;
+    Frame *f = thread != nullptr ? thread->currentFrame() : nullptr;
+    for (; f != nullptr && site.depth < ALLOC_STACK_DEPTH; f = f->prev) {
+        site.methods[site.depth] = f->owner;
+        site.pcs[site.depth] = f->pc;
+        site.depth++;
+    }
+
+    std::lock_guard<std::mutex> guard(statsLock);
+    classStats[cls].add(weight, size);
+    siteStats[site].add(weight, size);
+}
+
+std::string AllocationProfiler::siteName(const Site &site)
+{
+    if (site.depth == 0)
+        return "<runtime>";
+
+    std::ostringstream name;
+    for (int i = 0; i < site.depth; i++) {
+        Method *m = site.methods[i];
+        if (i > 0)
+            name << " <- ";
+        name << m->owner->name << '.'
+             << m->owner->classFile->getUtf8(m->methodInfo->nameIndex)
+             << '@' << site.pcs[i];
+    }
+    return name.str();
+}
+
+void AllocationProfiler::printTop(std::ostream &out, Rows rows,
+        bool byBytes, size_t limit)
+{
+    std::sort(rows.begin(), rows.end(),
+            [byBytes](const std::pair<std::string, Stats> &a,
+                      const std::pair<std::string, Stats> &b) {
+        if (byBytes)
+            return a.second.bytes > b.second.bytes;
+        return a.second.count > b.second.count;
+    });
+
+    for (size_t i = 0; i < rows.size() && i < limit; i++) {
+        Stats &stats = rows[i].second;
+        out << std::setw(14) << stats.bytes
+            << std::setw(12) << static_cast<uint64_t>(stats.count)
+            << std::setw(10) << stats.samples
+            << "  " << rows[i].first << std::endl;
+    }
+}
+
+void AllocationProfiler::report(std::ostream &out, size_t limit)
+{
+    std::lock_guard<std::mutex> guard(statsLock);
+    Rows classRows, siteRows;
+    for (auto &entry : classStats)
+        classRows.push_back(std::make_pair(entry.first->name, entry.second));
+    for (auto &entry : siteStats)
+        siteRows.push_back(std::make_pair(siteName(entry.first), entry.second));
+
+    const char *header = "         bytes       count   samples";
+
+    out << "Allocation profile, one sample per "
+        << sampleBytes << " bytes" << std::endl;
+    out << std::endl << "Top classes by bytes" << std::endl
+        << header << "  class" << std::endl;
+    printTop(out, classRows, true, limit);
+    out << std::endl << "Top classes by count" << std::endl
+        << header << "  class" << std::endl;
+    printTop(out, classRows, false, limit);
+    out << std::endl << "Top sites by bytes" << std::endl
+        << header << "  site" << std::endl;
+    printTop(out, siteRows, true, limit);
+    out << std::endl << "Top sites by count" << std::endl
+        << header << "  site" << std::endl;
+    printTop(out, siteRows, false, limit);
+}
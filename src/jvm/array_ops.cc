@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstring>
+
+#include <jvm/array_ops.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARRAY_OPS_X86
+#include <immintrin.h>
+
+/* Vector code is compiled for its own target, the rest of the VM is not */
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+const ArrayOps::Level ArrayOps::supported = ArrayOps::detect();
+ArrayOps::Level ArrayOps::active = ArrayOps::supported;
+
+ArrayOps::Level ArrayOps::detect()
+{
+#ifdef ARRAY_OPS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SSE2;
+#endif
+    return SCALAR;
+}
+
+void ArrayOps::limit(Level max)
+{
+    active = std::min(max, supported);
+}
+
+const char *ArrayOps::levelName(Level level)
+{
+    switch (level) {
+        case AVX2:
+            return "avx2";
+        case SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+/* The C library already picks vector code for moves */
+void ArrayOps::copy(void *dst, const void *src, size_t bytes)
+{
+    memmove(dst, src, bytes);
+}
+
+#ifdef ARRAY_OPS_X86
+TARGET_AVX2 static void fillAvx2(uint8_t *dst, const uint8_t *pattern,
+        size_t bytes)
+{
+    __m256i value = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(pattern));
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), value);
+    memcpy(dst + i, pattern, bytes - i);
+}
+
+TARGET_SSE2 static void fillSse2(uint8_t *dst, const uint8_t *pattern,
+        size_t bytes)
+{
+    __m128i value = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(pattern));
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), value);
+    memcpy(dst + i, pattern, bytes - i);
+}
+
+TARGET_AVX2 static bool equalsAvx2(const uint8_t *a, const uint8_t *b,
+        size_t bytes)
+{
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1)
+            return false;
+    }
+    return memcmp(a + i, b + i, bytes - i) == 0;
+}
+
+TARGET_SSE2 static bool equalsSse2(const uint8_t *a, const uint8_t *b,
+        size_t bytes)
+{
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff)
+            return false;
+    }
+    return memcmp(a + i, b + i, bytes - i) == 0;
+}
+
+/* Eight elements widened to int lanes as Java widens them */
+TARGET_AVX2 static __m256i load8(const int32_t *items)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(items));
+}
+
+TARGET_AVX2 static __m256i load8(const int16_t *items)
+{
+    return _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(items)));
+}
+
+TARGET_AVX2 static __m256i load8(const uint16_t *items)
+{
+    return _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(items)));
+}
+
+TARGET_AVX2 static __m256i load8(const int8_t *items)
+{
+    return _mm256_cvtepi8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(items)));
+}
+
+/*
+ * Lane k sums every element at k modulo 8, scaled by 31^8 per block, so
+ * the blocks contribute sum(lane[k] * 31^(7 - k)) to the hash.
+ */
+template<typename T>
+TARGET_AVX2 static uint32_t hashAvx2(const T *items, size_t count,
+        uint32_t hash, size_t &done)
+{
+    const uint32_t pow8 = 31u * 31 * 31 * 31 * 31 * 31 * 31 * 31;
+    const __m256i blockScale = _mm256_set1_epi32(pow8);
+    __m256i lanes = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        lanes = _mm256_add_epi32(_mm256_mullo_epi32(lanes, blockScale),
+                load8(items + i));
+        hash *= pow8;
+    }
+
+    uint32_t weights[8], sums[8];
+    uint32_t weight = 1;
+    for (int k = 7; k >= 0; k--) {
+        weights[k] = weight;
+        weight *= 31;
+    }
+    lanes = _mm256_mullo_epi32(lanes, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(weights)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(sums), lanes);
+    for (uint32_t sum : sums)
+        hash += sum;
+
+    done = i;
+    return hash;
+}
+#endif
+
+template<typename T>
+static int32_t hashItems(const T *items, size_t count)
+{
+    /* Unsigned, the hash wraps around as Java ints do */
+    uint32_t hash = 1;
+    size_t i = 0;
+#ifdef ARRAY_OPS_X86
+    if (ArrayOps::level() >= ArrayOps::AVX2)
+        hash = hashAvx2(items, count, hash, i);
+#endif
+    for (; i < count; i++)
+        hash = 31 * hash + (uint32_t) (int32_t) items[i];
+    return (int32_t) hash;
+}
+
+void ArrayOps::fill(void *dst, const void *value, size_t itemSize,
+        size_t count)
+{
+    uint8_t *out = static_cast<uint8_t *>(dst);
+    const uint8_t *item = static_cast<const uint8_t *>(value);
+    size_t bytes = itemSize * count;
+
+    /* Item size divides 32, so every chunk starts at an item boundary */
+    uint8_t pattern[32];
+    for (size_t i = 0; i < sizeof(pattern); i++)
+        pattern[i] = item[i % itemSize];
+
+    switch (active) {
+#ifdef ARRAY_OPS_X86
+        case AVX2:
+            fillAvx2(out, pattern, bytes);
+            return;
+        case SSE2:
+            fillSse2(out, pattern, bytes);
+            return;
+#endif
+        default:
+            for (size_t i = 0; i < bytes; i += itemSize)
+                memcpy(out + i, item, itemSize);
+    }
+}
+
+bool ArrayOps::equals(const void *a, const void *b, size_t bytes)
+{
+    const uint8_t *x = static_cast<const uint8_t *>(a);
+    const uint8_t *y = static_cast<const uint8_t *>(b);
+
+    switch (active) {
+#ifdef ARRAY_OPS_X86
+        case AVX2:
+            return equalsAvx2(x, y, bytes);
+        case SSE2:
+            return equalsSse2(x, y, bytes);
+#endif
+        default:
+            for (size_t i = 0; i < bytes; i++)
+                if (x[i] != y[i])
+                    return false;
+            return true;
+    }
+}
+
+int32_t ArrayOps::hashCode(const int32_t *items, size_t count)
+{
+    return hashItems(items, count);
+}
+
+int32_t ArrayOps::hashCode(const int16_t *items, size_t count)
+{
+    return hashItems(items, count);
+}
+
+int32_t ArrayOps::hashCode(const uint16_t *items, size_t count)
+{
+    return hashItems(items, count);
+}
+
+int32_t ArrayOps::hashCode(const int8_t *items, size_t count)
+{
+    return hashItems(items, count);
+}
@@ -0,0 +1,152 @@
+#include <class/java_class_builder.h>
+#include <jvm/bootstrap.h>
+
+const std::map<std::string, Bootstrap::Builder> Bootstrap::builders = {
+    {"java/lang/Object", objectClass},
+    {"java/lang/String", stringClass},
+    {"java/lang/System", systemClass},
+    {"java/io/PrintStream", printStreamClass},
+    {"java/lang/Thread", threadClass},
+    {"java/lang/Math", mathClass},
+    {"java/util/Arrays", arraysClass},
+};
+
+std::mutex Bootstrap::lock;
+std::map<std::string, ClassFile *> Bootstrap::built;
+
+ClassFile *Bootstrap::find(const std::string &name)
+{
+    auto builder = builders.find(name);
+    if (builder == builders.end())
+        return nullptr;
+
+    std::lock_guard<std::mutex> guard(lock);
+    ClassFile *&classFile = built[name];
+    if (classFile == nullptr)
+        classFile = builder->second();
+    return classFile;
+}
+
+/* Bodies come from Natives, the methods only declare them */
+static void nativeMethod(ClassBuilder &cb, std::string name,
+        std::string descriptor, uint16_t flags = ACC_PUBLIC)
+{
+    MethodBuilder *mb = cb.createMethod(name);
+    mb->setDescriptor(descriptor);
+    mb->setAccessFlags(flags | ACC_NATIVE);
+}
+
+static void constructor(ClassBuilder &cb, std::string super)
+{
+    MethodBuilder *mb = cb.createMethod("<init>");
+    mb->setAccessFlags(ACC_PUBLIC);
+    if (super.empty()) {
+        mb->setMax(0, 1);
+    } else {
+        mb->setMax(1, 1);
+        mb->local(opcodes::ALOAD, 0);
+        mb->invoke(opcodes::INVOKESPECIAL, super, "<init>", "()V");
+    }
+    mb->instruction(opcodes::RETURN);
+}
+
+ClassFile *Bootstrap::objectClass()
+{
+    ClassBuilder cb("java/lang/Object");
+    cb.setSuper("");
+    constructor(cb, "");
+    nativeMethod(cb, "wait", "()V", ACC_PUBLIC | ACC_FINAL);
+    nativeMethod(cb, "wait", "(J)V", ACC_PUBLIC | ACC_FINAL);
+    nativeMethod(cb, "notify", "()V", ACC_PUBLIC | ACC_FINAL);
+    nativeMethod(cb, "notifyAll", "()V", ACC_PUBLIC | ACC_FINAL);
+    return cb.build();
+}
+
+ClassFile *Bootstrap::stringClass()
+{
+    ClassBuilder cb("java/lang/String");
+    cb.addField("value", "[C", ACC_PRIVATE | ACC_FINAL);
+    constructor(cb, "java/lang/Object");
+    nativeMethod(cb, "length", "()I");
+    nativeMethod(cb, "charAt", "(I)C");
+    return cb.build();
+}
+
+ClassFile *Bootstrap::systemClass()
+{
+    ClassBuilder cb("java/lang/System");
+    cb.addField("out", "Ljava/io/PrintStream;",
+            ACC_PUBLIC | ACC_STATIC | ACC_FINAL);
+
+    MethodBuilder *mb = cb.createMethod("<clinit>");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(2, 0);
+    mb->type(opcodes::NEW, "java/io/PrintStream");
+    mb->instruction(opcodes::DUP);
+    mb->invoke(opcodes::INVOKESPECIAL, "java/io/PrintStream", "<init>", "()V");
+    mb->field(opcodes::PUTSTATIC, "java/lang/System", "out",
+            "Ljava/io/PrintStream;");
+    mb->instruction(opcodes::RETURN);
+
+    nativeMethod(cb, "currentTimeMillis", "()J", ACC_PUBLIC | ACC_STATIC);
+    nativeMethod(cb, "nanoTime", "()J", ACC_PUBLIC | ACC_STATIC);
+    nativeMethod(cb, "identityHashCode", "(Ljava/lang/Object;)I",
+            ACC_PUBLIC | ACC_STATIC);
+    nativeMethod(cb, "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V",
+            ACC_PUBLIC | ACC_STATIC);
+    return cb.build();
+}
+
+ClassFile *Bootstrap::printStreamClass()
+{
+    ClassBuilder cb("java/io/PrintStream");
+    constructor(cb, "java/lang/Object");
+    for (const char *name : {"print", "println"})
+        for (const char *descriptor : {"(Ljava/lang/String;)V", "(I)V",
+                "(J)V", "(C)V", "(Z)V"})
+            nativeMethod(cb, name, descriptor);
+    nativeMethod(cb, "println", "()V");
+    return cb.build();
+}
+
+ClassFile *Bootstrap::threadClass()
+{
+    ClassBuilder cb("java/lang/Thread");
+    constructor(cb, "java/lang/Object");
+    nativeMethod(cb, "start", "()V");
+    nativeMethod(cb, "join", "()V", ACC_PUBLIC | ACC_FINAL);
+
+    MethodBuilder *mb = cb.createMethod("run");
+    mb->setAccessFlags(ACC_PUBLIC);
+    mb->setMax(0, 1);
+    mb->instruction(opcodes::RETURN);
+    return cb.build();
+}
+
+ClassFile *Bootstrap::mathClass()
+{
+    ClassBuilder cb("java/lang/Math");
+    for (const char *descriptor : {"(I)I", "(J)J"})
+        nativeMethod(cb, "abs", descriptor, ACC_PUBLIC | ACC_STATIC);
+    for (const char *name : {"max", "min"})
+        for (const char *descriptor : {"(II)I", "(JJ)J"})
+            nativeMethod(cb, name, descriptor, ACC_PUBLIC | ACC_STATIC);
+    return cb.build();
+}
+
+ClassFile *Bootstrap::arraysClass()
+{
+    ClassBuilder cb("java/util/Arrays");
+    for (std::string type : {"I", "J", "S", "C", "B", "Z", "F", "D"}) {
+        nativeMethod(cb, "fill", "([" + type + type + ")V",
+                ACC_PUBLIC | ACC_STATIC);
+        nativeMethod(cb, "equals", "([" + type + "[" + type + ")Z",
+                ACC_PUBLIC | ACC_STATIC);
+        nativeMethod(cb, "hashCode", "([" + type + ")I",
+                ACC_PUBLIC | ACC_STATIC);
+        if (type != "Z")
+            nativeMethod(cb, "sort", "([" + type + ")V",
+                    ACC_PUBLIC | ACC_STATIC);
+    }
+    return cb.build();
+}
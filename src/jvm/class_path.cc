@@ -0,0 +1,122 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <io/zip_archive.h>
+#include <jvm/class_path.h>
+
+std::vector<ClassPath::Entry> ClassPath::entries;
+std::mutex ClassPath::missingLock;
+std::unordered_set<std::string> ClassPath::missing;
+
+static bool isArchive(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+
+    std::string extension = path.substr(dot);
+    return extension == ".jar" || extension == ".zip";
+}
+
+void ClassPath::set(const std::string &classPath)
+{
+    entries.clear();
+    missing.clear();
+
+    size_t start = 0;
+    while (start <= classPath.length()) {
+        size_t end = classPath.find(':', start);
+        if (end == std::string::npos)
+            end = classPath.length();
+        std::string path = classPath.substr(start, end - start);
+        start = end + 1;
+
+        if (path.empty())
+            path = ".";
+        if (!isArchive(path)) {
+            entries.push_back({path, nullptr});
+            continue;
+        }
+
+        ZipArchive *archive = ZipArchive::open(path);
+        if (archive == nullptr) {
+            std::cerr << "Ignoring unreadable archive " << path << std::endl;
+            continue;
+        }
+        entries.push_back({path, archive});
+    }
+}
+
+bool ClassPath::contains(const std::string &className)
+{
+    if (entries.empty())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> guard(missingLock);
+        if (missing.find(className) != missing.end())
+            return false;
+    }
+
+    std::string fileName = className + ".class";
+    for (Entry &entry : entries) {
+        if (entry.archive != nullptr ? entry.archive->contains(fileName) :
+                std::ifstream((entry.directory + "/" + fileName).c_str()).good())
+            return true;
+    }
+    return false;
+}
+
+std::string ClassPath::source(const std::string &className)
+{
+    std::string fileName = className + ".class";
+    for (Entry &entry : entries) {
+        if (entry.archive != nullptr) {
+            if (entry.archive->contains(fileName))
+                return entry.directory;
+            continue;
+        }
+
+        std::string path = entry.directory + "/" + fileName;
+        if (std::ifstream(path.c_str()).good())
+            return path;
+    }
+    return "";
+}
+
+const uint8_t *ClassPath::find(const std::string &className, size_t &length,
+        std::vector<uint8_t> &buffer)
+{
+    if (entries.empty())
+        return nullptr;
+
+    {
+        std::lock_guard<std::mutex> guard(missingLock);
+        if (missing.find(className) != missing.end())
+            return nullptr;
+    }
+
+    std::string fileName = className + ".class";
+    for (Entry &entry : entries) {
+        if (entry.archive != nullptr) {
+            const uint8_t *data = entry.archive->read(fileName, length, buffer);
+            if (data != nullptr)
+                return data;
+            continue;
+        }
+
+        std::ifstream f((entry.directory + "/" + fileName).c_str(),
+                std::ifstream::binary);
+        if (!f)
+            continue;
+        buffer.assign(std::istreambuf_iterator<char>(f),
+                std::istreambuf_iterator<char>());
+        length = buffer.size();
+        return buffer.data();
+    }
+
+    std::lock_guard<std::mutex> guard(missingLock);
+    missing.insert(className);
+    return nullptr;
+}
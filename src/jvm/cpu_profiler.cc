@@ -0,0 +1,196 @@
+#include <config.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef HAVE_SYS_TIME_H
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+#include <jvm/jvm.h>
+#include <jvm/cpu_profiler.h>
+
+/* Sample slot states */
+static const int SAMPLE_FREE = 0, SAMPLE_WRITING = 1, SAMPLE_READY = 2;
+
+std::atomic<bool> CpuProfiler::enabled{false};
+CpuProfiler::Sample *CpuProfiler::buffer = nullptr;
+std::atomic<size_t> CpuProfiler::nextSample{0};
+std::atomic<uint64_t> CpuProfiler::dropped{0}, CpuProfiler::idle{0};
+std::string CpuProfiler::outputPath;
+std::map<CpuProfiler::Stack, uint64_t> CpuProfiler::stacks;
+std::thread CpuProfiler::drainThread;
+std::mutex CpuProfiler::drainLock;
+std::condition_variable CpuProfiler::drainCond;
+bool CpuProfiler::draining = false;
+
+bool CpuProfiler::start(uint32_t hz, const std::string &outputPath)
+{
+#ifdef HAVE_SYS_TIME_H
+    CpuProfiler::outputPath = outputPath;
+    buffer = new Sample[bufferSize];
+
+    draining = true;
+    drainThread = std::thread(drainLoop);
+
+    struct sigaction action = {};
+    action.sa_handler = handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    enabled = true;
+
+    uint32_t interval = 1000000 / (hz == 0 ? 1 : hz);
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CpuProfiler::stop()
+{
+#ifdef HAVE_SYS_TIME_H
+    if (!enabled)
+        return;
+
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    enabled = false;
+
+    {
+        std::lock_guard<std::mutex> guard(drainLock);
+        draining = false;
+    }
+    drainCond.notify_all();
+    drainThread.join();
+
+    drain();
+    write();
+#endif
+}
+
+void CpuProfiler::handler(int signal)
+{
+    if (!enabled.load(std::memory_order_relaxed))
+        return;
+
+    /* Only the interrupted thread touches its frames, no locks here */
+    Thread *thread = Thread::current;
+    Frame *f = thread != nullptr ? thread->currentFrame() : nullptr;
+    if (f == nullptr) {
+        idle.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Sample &sample = buffer[nextSample.fetch_add(1) % bufferSize];
+    int expected = SAMPLE_FREE;
+    if (!sample.state.compare_exchange_strong(expected, SAMPLE_WRITING,
+            std::memory_order_acquire)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int depth = 0;
+    for (; f != nullptr && depth < CPU_STACK_DEPTH; f = f->prev) {
+        sample.methods[depth] = f->owner;
+        sample.pcs[depth] = f->pc;
+        depth++;
+    }
+    sample.depth = depth;
+    sample.state.store(SAMPLE_READY, std::memory_order_release);
+}
+
+void CpuProfiler::drainLoop()
+{
+    std::unique_lock<std::mutex> guard(drainLock);
+
+    while (!drainCond.wait_for(guard, std::chrono::milliseconds(50),
+            [] { return !draining; }))
+        drain();
+}
+
+void CpuProfiler::drain()
+{
+    for (size_t i = 0; i < bufferSize; i++) {
+        Sample &sample = buffer[i];
+        if (sample.state.load(std::memory_order_acquire) != SAMPLE_READY)
+            continue;
+
+        /* Outermost frame first, as collapsed stacks expect */
+        Stack stack;
+        for (int j = sample.depth - 1; j >= 0; j--)
+            stack.push_back(std::make_pair(sample.methods[j], sample.pcs[j]));
+        sample.state.store(SAMPLE_FREE, std::memory_order_release);
+
+        stacks[stack]++;
+    }
+}
+
+int CpuProfiler::lineOf(Method *m, uint32_t pc)
+{
+    if (m->codeAttr == nullptr)
+        return -1;
+
+    int line = -1;
+    uint16_t bestPc = 0;
+    for (AttributeInfo *attr : m->codeAttr->attributes) {
+        LineNumberTableAttribute *table =
+                dynamic_cast<LineNumberTableAttribute *>(attr);
+        if (table == nullptr)
+            continue;
+        for (const LineNumber &entry : table->lineNumberTable) {
+            if (entry.startPc <= pc && (line < 0 || entry.startPc >= bestPc)) {
+                bestPc = entry.startPc;
+                line = entry.lineNumber;
+            }
+        }
+    }
+    return line;
+}
+
+std::string CpuProfiler::frameName(Method *m, uint32_t pc)
+{
+    std::ostringstream name;
+    name << m->owner->name << '.'
+         << m->owner->classFile->getUtf8(m->methodInfo->nameIndex);
+
+    int line = lineOf(m, pc);
+    if (line >= 0)
+        name << ':' << line;
+    else
+        name << '@' << pc;
+    return name.str();
+}
+
+void CpuProfiler::write()
+{
+    /* Different pcs on the same line fold into one stack */
+    std::map<std::string, uint64_t> collapsed;
+    uint64_t total = 0;
+    for (auto &entry : stacks) {
+        std::string line;
+        for (auto &frame : entry.first) {
+            if (!line.empty())
+                line += ';';
+            line += frameName(frame.first, frame.second);
+        }
+        collapsed[line] += entry.second;
+        total += entry.second;
+    }
+
+    std::ofstream out(outputPath);
+    for (auto &entry : collapsed)
+        out << entry.first << ' ' << entry.second << std::endl;
+
+    std::cerr << "CPU profile: " << total << " samples written to "
+              << outputPath << ", " << idle << " outside interpreter, "
+              << dropped << " dropped" << std::endl;
+}
@@ -0,0 +1,36 @@
+#include <jvm/embed.h>
+#include <jvm/isolate.h>
+
+MethodHandle MethodHandle::find(const std::string &className,
+        const std::string &name, const std::string &descriptor)
+{
+    /* getClass stops the VM for a missing class, the host must not */
+    Class *cls = ClassCache::findLoaded(className);
+    if (cls == nullptr) {
+        if (!ClassLoader::canLoad(className))
+            return MethodHandle();
+        cls = ClassCache::getClass(className);
+    }
+
+    Symbol *nameSymbol = Symbol::intern(name),
+            *descriptorSymbol = Symbol::intern(descriptor);
+
+    Method *method = nullptr;
+    for (Class *c = cls; c != nullptr && method == nullptr; c = c->super)
+        method = c->getMethod(nameSymbol, descriptorSymbol);
+
+    if (method == nullptr || method->code == nullptr)
+        return MethodHandle();
+    return MethodHandle(method);
+}
+
+CallContext::CallContext(Isolate *isolate) :
+    thread(isolate)
+{
+}
+
+CallContext &CallContext::current()
+{
+    static thread_local CallContext context(Isolate::main());
+    return context;
+}
@@ -0,0 +1,434 @@
+#include <algorithm>
+
+#include <jvm/jvm.h>
+#include <jvm/escape_analysis.h>
+#include <class/java_opcodes.h>
+
+/* Used for methods without code or bound to native code, whose
+ * bytecode is not what runs, and for recursive calls */
+static EscapeInfo conservativeInfo;
+
+bool EscapeInfo::isLocalSite(uint32_t pc)
+{
+    return std::binary_search(localSites.begin(), localSites.end(), pc);
+}
+
+/* Recursive as callees are analyzed from inside the analysis */
+static std::recursive_mutex analysisLock;
+
+EscapeInfo *EscapeAnalysis::get(Method *m)
+{
+    EscapeInfo *info = m->escapeInfo.load(std::memory_order_acquire);
+    if (info != nullptr)
+        return info;
+    if (m->codeAttr == nullptr || m->nativeCode != nullptr)
+        return &conservativeInfo;
+
+    std::lock_guard<std::recursive_mutex> guard(analysisLock);
+    if (m->escapeInfo != nullptr)
+        return m->escapeInfo;
+    if (m->escapeAnalyzing)
+        return &conservativeInfo;
+
+    m->escapeAnalyzing = true;
+    EscapeAnalysis analysis(m);
+    m->escapeInfo.store(analysis.run(), std::memory_order_release);
+    m->escapeAnalyzing = false;
+
+    return m->escapeInfo;
+}
+
+EscapeAnalysis::EscapeAnalysis(Method *m) :
+    method(m),
+    maxLocals(m->codeAttr->maxLocals),
+    maxStack(m->codeAttr->maxStack),
+    states(m->codeLength)
+{
+}
+
+EscapeInfo *EscapeAnalysis::run()
+{
+    State entry;
+    entry.locals.assign(maxLocals, 0);
+    entry.stack.assign(maxStack, 0);
+
+    /* Each argument slot is a source of its own */
+    uint16_t argSlots = method->argSlots;
+    if (!(method->methodInfo->accessFlags & ACC_STATIC))
+        argSlots++;
+    for (uint16_t i = 0; i < argSlots && i < maxLocals && i < maxSources; i++)
+        entry.locals[i] = 1ull << i;
+    argSources = argSlots < maxSources ? argSlots : maxSources;
+
+    if (method->codeLength > 0)
+        flow(0, entry);
+
+    while (!worklist.empty() && !failed) {
+        uint32_t pc = worklist.back();
+        worklist.pop_back();
+        State s = states[pc];
+        step(pc, s);
+    }
+
+    EscapeInfo *info = new EscapeInfo;
+    if (failed)
+        return info;
+
+    info->escapingArgs = escaped & ((argSources == maxSources) ?
+            ~0ull : (1ull << argSources) - 1);
+    for (size_t i = 0; i < sitePcs.size(); i++)
+        if (!(escaped & (1ull << (argSources + i))))
+            info->localSites.push_back(sitePcs[i]);
+    std::sort(info->localSites.begin(), info->localSites.end());
+
+    return info;
+}
+
+void EscapeAnalysis::flow(uint32_t pc, State &s)
+{
+    if (pc >= states.size()) {
+        failed = true;
+        return;
+    }
+
+    State &target = states[pc];
+    if (!target.reached) {
+        target = s;
+        target.reached = true;
+        worklist.push_back(pc);
+        return;
+    }
+
+    /* Merge is a union of sources, states only grow */
+    bool changed = false;
+    for (uint16_t i = 0; i < maxLocals; i++) {
+        Sources merged = target.locals[i] | s.locals[i];
+        changed |= merged != target.locals[i];
+        target.locals[i] = merged;
+    }
+    for (uint16_t i = 0; i < s.stackTop && i < target.stackTop; i++) {
+        Sources merged = target.stack[i] | s.stack[i];
+        changed |= merged != target.stack[i];
+        target.stack[i] = merged;
+    }
+    if (changed)
+        worklist.push_back(pc);
+}
+
+EscapeAnalysis::Sources EscapeAnalysis::siteSource(uint32_t pc)
+{
+    for (size_t i = 0; i < sitePcs.size(); i++)
+        if (sitePcs[i] == pc)
+            return 1ull << (argSources + i);
+
+    /* Untracked sites are allocated on heap */
+    if (argSources + sitePcs.size() >= (size_t) maxSources)
+        return 0;
+
+    sitePcs.push_back(pc);
+    return 1ull << (argSources + sitePcs.size() - 1);
+}
+
+void EscapeAnalysis::step(uint32_t pc, State &s)
+{
+    uint8_t *code = method->code;
+    ClassFile *classFile = method->owner->classFile;
+    uint8_t opcode = code[pc];
+    uint16_t index = 0;
+    if (pc + 2 < method->codeLength)
+        index = (code[pc + 1] << 8) | code[pc + 2];
+    int16_t branch = (int16_t) index;
+    std::vector<Sources> &stack = s.stack;
+    uint16_t &top = s.stackTop;
+
+    switch (opcode) {
+        case opcodes::BIPUSH:
+        case opcodes::LDC:
+            stack[top++] = 0;
+            flow(pc + 2, s);
+            break;
+        case opcodes::SIPUSH:
+        case opcodes::LDC_W:
+            stack[top++] = 0;
+            flow(pc + 3, s);
+            break;
+        case opcodes::LDC2_W:
+            stack[top++] = 0;
+            stack[top++] = 0;
+            flow(pc + 3, s);
+            break;
+        case opcodes::ICONST_M1:
+        case opcodes::ICONST_0:
+        case opcodes::ICONST_1:
+        case opcodes::ICONST_2:
+        case opcodes::ICONST_3:
+        case opcodes::ICONST_4:
+        case opcodes::ICONST_5:
+            stack[top++] = 0;
+            flow(pc + 1, s);
+            break;
+        /* Longs are never references */
+        case opcodes::LCONST_0:
+        case opcodes::LCONST_1:
+        case opcodes::LLOAD_0:
+        case opcodes::LLOAD_1:
+        case opcodes::LLOAD_2:
+        case opcodes::LLOAD_3:
+            stack[top++] = 0;
+            stack[top++] = 0;
+            flow(pc + 1, s);
+            break;
+        case opcodes::LLOAD:
+            stack[top++] = 0;
+            stack[top++] = 0;
+            flow(pc + 2, s);
+            break;
+        case opcodes::LSTORE:
+            top -= 2;
+            s.locals[code[pc + 1]] = 0;
+            s.locals[code[pc + 1] + 1] = 0;
+            flow(pc + 2, s);
+            break;
+        case opcodes::LSTORE_0:
+        case opcodes::LSTORE_1:
+        case opcodes::LSTORE_2:
+        case opcodes::LSTORE_3:
+            top -= 2;
+            s.locals[opcode - opcodes::LSTORE_0] = 0;
+            s.locals[opcode - opcodes::LSTORE_0 + 1] = 0;
+            flow(pc + 1, s);
+            break;
+        case opcodes::LADD:
+        case opcodes::LSUB:
+            top -= 2;
+            flow(pc + 1, s);
+            break;
+        case opcodes::I2L:
+            stack[top - 1] = 0;
+            stack[top++] = 0;
+            flow(pc + 1, s);
+            break;
+        case opcodes::L2I:
+            top--;
+            stack[top - 1] = 0;
+            flow(pc + 1, s);
+            break;
+        case opcodes::LCMP:
+            top -= 3;
+            stack[top - 1] = 0;
+            flow(pc + 1, s);
+            break;
+        case opcodes::ILOAD:
+        case opcodes::ALOAD:
+            stack[top++] = s.locals[code[pc + 1]];
+            flow(pc + 2, s);
+            break;
+        case opcodes::ILOAD_0:
+        case opcodes::ILOAD_1:
+        case opcodes::ILOAD_2:
+        case opcodes::ILOAD_3:
+            stack[top++] = s.locals[opcode - opcodes::ILOAD_0];
+            flow(pc + 1, s);
+            break;
+        case opcodes::ALOAD_0:
+        case opcodes::ALOAD_1:
+        case opcodes::ALOAD_2:
+        case opcodes::ALOAD_3:
+            stack[top++] = s.locals[opcode - opcodes::ALOAD_0];
+            flow(pc + 1, s);
+            break;
+        case opcodes::ISTORE:
+        case opcodes::ASTORE:
+            s.locals[code[pc + 1]] = stack[--top];
+            flow(pc + 2, s);
+            break;
+        case opcodes::ISTORE_0:
+        case opcodes::ISTORE_1:
+        case opcodes::ISTORE_2:
+        case opcodes::ISTORE_3:
+            s.locals[opcode - opcodes::ISTORE_0] = stack[--top];
+            flow(pc + 1, s);
+            break;
+        case opcodes::ASTORE_0:
+        case opcodes::ASTORE_1:
+        case opcodes::ASTORE_2:
+        case opcodes::ASTORE_3:
+            s.locals[opcode - opcodes::ASTORE_0] = stack[--top];
+            flow(pc + 1, s);
+            break;
+        case opcodes::IALOAD:
+        case opcodes::BALOAD:
+        case opcodes::IADD:
+        case opcodes::ISUB:
+        case opcodes::IMUL:
+            top -= 2;
+            stack[top++] = 0;
+            flow(pc + 1, s);
+            break;
+        case opcodes::IASTORE:
+        case opcodes::BASTORE:
+            top -= 3;
+            flow(pc + 1, s);
+            break;
+        case opcodes::IINC:
+            flow(pc + 3, s);
+            break;
+        case opcodes::DUP:
+            stack[top] = stack[top - 1];
+            top++;
+            flow(pc + 1, s);
+            break;
+        case opcodes::DUP_X1:
+            stack[top] = stack[top - 1];
+            stack[top - 1] = stack[top - 2];
+            stack[top - 2] = stack[top];
+            top++;
+            flow(pc + 1, s);
+            break;
+        case opcodes::POP:
+        case opcodes::MONITORENTER:
+        case opcodes::MONITOREXIT:
+            top--;
+            flow(pc + 1, s);
+            break;
+        case opcodes::POP2:
+            top -= 2;
+            flow(pc + 1, s);
+            break;
+        case opcodes::IFNE:
+        case opcodes::IFEQ:
+        case opcodes::IFLT:
+        case opcodes::IFGE:
+        case opcodes::IFGT:
+        case opcodes::IFLE:
+            top--;
+            flow(pc + 3, s);
+            flow(pc + branch, s);
+            break;
+        case opcodes::IF_ICMPLT:
+        case opcodes::IF_ICMPGE:
+        case opcodes::IF_ICMPLE:
+            top -= 2;
+            flow(pc + 3, s);
+            flow(pc + branch, s);
+            break;
+        case opcodes::GOTO:
+            flow(pc + branch, s);
+            break;
+        case opcodes::GETFIELD:
+        case opcodes::PUTFIELD:
+        case opcodes::GETSTATIC:
+        case opcodes::PUTSTATIC: {
+            RefInfo *ref = static_cast<RefInfo *>(classFile->constantPool[index - 1]);
+            RefInfo *nameType = static_cast<RefInfo *>(classFile->constantPool[ref->secondIndex - 1]);
+            uint8_t slots = slotsOf(classFile->getUtf8(nameType->secondIndex)[0]);
+
+            if (opcode == opcodes::PUTFIELD || opcode == opcodes::PUTSTATIC) {
+                /* Anything stored to the heap escapes */
+                for (uint8_t i = 0; i < slots; i++)
+                    escaped |= stack[--top];
+            }
+            if (opcode == opcodes::GETFIELD || opcode == opcodes::PUTFIELD)
+                top--;
+            if (opcode == opcodes::GETFIELD || opcode == opcodes::GETSTATIC) {
+                /* Loaded values are heap objects, never local ones */
+                for (uint8_t i = 0; i < slots; i++)
+                    stack[top++] = 0;
+            }
+            flow(pc + 3, s);
+            break;
+        }
+        case opcodes::INVOKESTATIC:
+        case opcodes::INVOKESPECIAL:
+        case opcodes::INVOKEVIRTUAL:
+            invoke(pc, s, opcode);
+            flow(pc + 3, s);
+            break;
+        case opcodes::NEW:
+            stack[top++] = siteSource(pc);
+            flow(pc + 3, s);
+            break;
+        case opcodes::NEWARRAY:
+            stack[top - 1] = 0;
+            flow(pc + 2, s);
+            break;
+        case opcodes::ARETURN:
+            escaped |= stack[--top];
+            break;
+        case opcodes::IRETURN:
+        case opcodes::LRETURN:
+        case opcodes::RETURN:
+            break;
+        default:
+            /* Unknown instruction, assume that everything escapes */
+            failed = true;
+            break;
+    }
+}
+
+void EscapeAnalysis::invoke(uint32_t pc, State &s, uint8_t opcode)
+{
+    ClassFile *classFile = method->owner->classFile;
+    uint16_t index = (method->code[pc + 1] << 8) | method->code[pc + 2];
+    RefInfo *ref = static_cast<RefInfo *>(classFile->constantPool[index - 1]);
+    RefInfo *nameType = static_cast<RefInfo *>(classFile->constantPool[ref->secondIndex - 1]);
+    Symbol *name = classFile->getSymbol(nameType->firstIndex);
+    Symbol *descriptor = classFile->getSymbol(nameType->secondIndex);
+
+    std::vector<uint8_t> argSlots;
+    uint8_t returnSlots;
+    parseDescriptor(descriptor->str, argSlots, returnSlots);
+
+    uint16_t slots = opcode == opcodes::INVOKESTATIC ? 0 : 1;
+    for (uint8_t argSize : argSlots)
+        slots += argSize;
+
+    /* Only statically bound callees can be looked into */
+    uint64_t calleeEscaping = ~0ull;
+    if (opcode != opcodes::INVOKEVIRTUAL) {
+        Class *cls = method->owner->resolveClass(ref->firstIndex);
+        Method *callee = nullptr;
+        for (; cls != nullptr && callee == nullptr; cls = cls->super)
+            callee = cls->getMethod(name, descriptor);
+        if (callee != nullptr)
+            calleeEscaping = get(callee)->escapingArgs;
+    }
+
+    s.stackTop -= slots;
+    for (uint16_t i = 0; i < slots; i++)
+        if (i >= 64 || (calleeEscaping & (1ull << i)))
+            escaped |= s.stack[s.stackTop + i];
+
+    /* Returned objects come from the heap or from escaped arguments */
+    for (uint8_t i = 0; i < returnSlots; i++)
+        s.stack[s.stackTop++] = 0;
+}
+
+void EscapeAnalysis::parseDescriptor(const std::string &descriptor,
+        std::vector<uint8_t> &argSlots, uint8_t &returnSlots)
+{
+    size_t i = 1;
+    while (descriptor[i] != ')') {
+        size_t start = i;
+        while (descriptor[i] == '[')
+            i++;
+        if (descriptor[i] == 'L')
+            i = descriptor.find(';', i);
+        argSlots.push_back(descriptor[start] == '[' ? 1 : slotsOf(descriptor[start]));
+        i++;
+    }
+    returnSlots = slotsOf(descriptor[i + 1]);
+}
+
+uint8_t EscapeAnalysis::slotsOf(char type)
+{
+    switch (type) {
+        case 'V':
+            return 0;
+        case 'J':
+        case 'D':
+            return 2;
+        default:
+            return 1;
+    }
+}
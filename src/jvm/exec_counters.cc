@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <jvm/jvm.h>
+#include <jvm/exec_counters.h>
+#include <class/java_opcodes.h>
+
+bool ExecutionCounters::enabled = false;
+thread_local ExecutionCounters::Counters *ExecutionCounters::counters = nullptr;
+std::mutex ExecutionCounters::listLock;
+std::vector<ExecutionCounters::Counters *> ExecutionCounters::allCounters;
+
+void ExecutionCounters::enable()
+{
+    enabled = true;
+}
+
+ExecutionCounters::Counters *ExecutionCounters::attach()
+{
+    /* Kept after the thread exits, the report needs them */
+    counters = new Counters;
+    std::lock_guard<std::mutex> guard(listLock);
+    allCounters.push_back(counters);
+    return counters;
+}
+
+void ExecutionCounters::invoked(Method *m)
+{
+    Counters *c = counters;
+    if (c == nullptr)
+        c = attach();
+    c->methods[m].invocations++;
+    /* Instruction counting refreshes the cached entry on next use */
+    c->lastMethod = nullptr;
+}
+
+std::string ExecutionCounters::opcodeName(uint8_t opcode)
+{
+    if (!opcodes::names[opcode].empty())
+        return opcodes::names[opcode];
+
+    std::ostringstream name;
+    name << "0x" << std::hex << static_cast<int>(opcode);
+    return name.str();
+}
+
+std::string ExecutionCounters::methodName(Method *m)
+{
+    return m->owner->name + '.' +
+            m->owner->classFile->getUtf8(m->methodInfo->nameIndex) +
+            m->owner->classFile->getUtf8(m->methodInfo->descriptorIndex);
+}
+
+void ExecutionCounters::report(std::ostream &out, size_t limit)
+{
+    std::lock_guard<std::mutex> guard(listLock);
+
+    uint64_t opcodeTotals[256] = {};
+    std::map<std::pair<uint8_t, uint8_t>, uint64_t> pairTotals;
+    std::map<Method *, MethodCounts> methodTotals;
+    uint64_t total = 0;
+
+    for (Counters *c : allCounters) {
+        for (int i = 0; i < 256; i++) {
+            opcodeTotals[i] += c->opcodes[i];
+            total += c->opcodes[i];
+            for (int j = 0; j < 256; j++)
+                if (c->pairs[i][j] != 0)
+                    pairTotals[std::make_pair(i, j)] += c->pairs[i][j];
+        }
+        for (auto &entry : c->methods) {
+            methodTotals[entry.first].instructions += entry.second.instructions;
+            methodTotals[entry.first].invocations += entry.second.invocations;
+        }
+    }
+
+    typedef std::pair<std::string, uint64_t> Row;
+    auto printTop = [&out, limit, total](std::vector<Row> rows) {
+        std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+            return a.second > b.second;
+        });
+        for (size_t i = 0; i < rows.size() && i < limit; i++)
+            out << std::setw(14) << rows[i].second
+                << std::setw(8) << std::fixed << std::setprecision(2)
+                << 100.0 * rows[i].second / (total == 0 ? 1 : total)
+                << "%  " << rows[i].first << std::endl;
+    };
+
+    std::vector<Row> opcodeRows, pairRows;
+    for (int i = 0; i < 256; i++)
+        if (opcodeTotals[i] != 0)
+            opcodeRows.push_back(Row(opcodeName(i), opcodeTotals[i]));
+    for (auto &entry : pairTotals)
+        pairRows.push_back(Row(opcodeName(entry.first.first) + " " +
+                opcodeName(entry.first.second), entry.second));
+
+    out << "Execution counts, " << total << " instructions" << std::endl;
+    out << std::endl << "Top opcodes" << std::endl;
+    printTop(opcodeRows);
+    out << std::endl << "Top opcode pairs" << std::endl;
+    printTop(pairRows);
+
+    std::vector<std::pair<Method *, MethodCounts>> methodRows(
+            methodTotals.begin(), methodTotals.end());
+    std::sort(methodRows.begin(), methodRows.end(),
+            [](const std::pair<Method *, MethodCounts> &a,
+               const std::pair<Method *, MethodCounts> &b) {
+        return a.second.instructions > b.second.instructions;
+    });
+
+    out << std::endl << "Top methods by instructions" << std::endl
+        << "  instructions    calls  per call  method" << std::endl;
+    for (size_t i = 0; i < methodRows.size() && i < limit; i++) {
+        MethodCounts &counts = methodRows[i].second;
+        uint64_t calls = counts.invocations == 0 ? 1 : counts.invocations;
+        out << std::setw(14) << counts.instructions
+            << std::setw(9) << counts.invocations
+            << std::setw(10) << counts.instructions / calls
+            << "  " << methodName(methodRows[i].first) << std::endl;
+    }
+}
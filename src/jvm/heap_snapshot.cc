@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include <io/byte_buffer.h>
+#include <io/memory_byte_reader.h>
+#include <jvm/jvm.h>
+#include <jvm/heap_snapshot.h>
+#include <jvm/isolate.h>
+
+static const uint8_t SNAPSHOT_MAGIC[4] = {'J', 'H', 'S', '1'};
+/* Payloads are raw memory, a snapshot is only valid for this build */
+static const uint32_t SNAPSHOT_VERSION = sizeof(uintptr_t) << 16 | 3;
+/* Magic, version and the length of what follows */
+static const size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 8;
+
+static bool isReference(char type)
+{
+    return type == 'L' || type == '[';
+}
+
+/* Bytes after the header of an object, array length included */
+static uint32_t payloadSize(Object *obj)
+{
+    return obj->blockSize() - (sizeof(Object) - 1);
+}
+
+static void writeString(ByteWriter &out, const std::string &str)
+{
+    out.write((uint16_t) str.length());
+    out.write((uint8_t *) str.data(), str.length());
+}
+
+static std::string readString(ByteReader &in)
+{
+    std::string str(in.read16(), '\0');
+    in.read((uint8_t *) &str[0], str.length());
+    return str;
+}
+
+/* Fields by name, the order of Class::fields differs between runs */
+static std::vector<Field> sortedFields(Class *cls)
+{
+    std::vector<Field> fields(cls->fields);
+    std::sort(fields.begin(), fields.end(), [](const Field &a, const Field &b) {
+        return a.name->str < b.name->str;
+    });
+    return fields;
+}
+
+static void writeFields(ByteWriter &out, Class *cls)
+{
+    std::vector<Field> fields = sortedFields(cls);
+    out.write((uint16_t) fields.size());
+    for (Field &field : fields) {
+        writeString(out, field.name->str);
+        writeString(out, field.descriptor->str);
+        out.write(field.offset);
+        out.write((uint8_t) field.isStatic);
+    }
+}
+
+static bool readFields(ByteReader &in, Class *cls)
+{
+    std::vector<Field> fields = sortedFields(cls);
+    if (in.read16() != fields.size())
+        return false;
+
+    for (Field &field : fields) {
+        std::string name = readString(in);
+        std::string descriptor = readString(in);
+        uint16_t offset = in.read16();
+        bool isStatic = in.read8();
+        if (name != field.name->str || descriptor != field.descriptor->str ||
+                offset != field.offset || isStatic != field.isStatic)
+            return false;
+    }
+    return true;
+}
+
+/* Loading a class whose file is gone would fail, so it is checked first */
+static bool canRestore(const std::string &name)
+{
+    if (name.empty())
+        return false;
+    if (ClassCache::findLoaded(name) != nullptr)
+        return true;
+    if (name[0] != '[')
+        return ClassLoader::canLoad(name);
+    if (name.length() < 2)
+        return false;
+    if (name[1] == 'L')
+        return canRestore(name.substr(2, name.length() - 3));
+    if (name[1] == '[')
+        return canRestore(name.substr(1));
+    return true;
+}
+
+void HeapSnapshot::staticReferences(Class *cls, uint8_t *statics,
+        const SlotVisitor &visit)
+{
+    for (Field &field : cls->fields)
+        if (field.isStatic && isReference(field.type))
+            visit(*reinterpret_cast<uintptr_t *>(&statics[field.offset]));
+}
+
+void HeapSnapshot::objectReferences(Object *obj, const SlotVisitor &visit)
+{
+    Class *cls = obj->cls;
+    if (cls->classFile != nullptr) {
+        for (Class *c = cls; c != nullptr; c = c->super)
+            for (Field &field : c->fields)
+                if (!field.isStatic && isReference(field.type))
+                    visit(*reinterpret_cast<uintptr_t *>(&obj->fields[field.offset]));
+        return;
+    }
+
+    if (static_cast<ArrayClass *>(cls)->arrayOfPrimitives)
+        return;
+
+    int32_t length = *reinterpret_cast<int32_t *>(obj->fields);
+    uintptr_t *items = reinterpret_cast<uintptr_t *>(obj->fields + INTEGER_SIZE);
+    for (int32_t i = 0; i < length; i++)
+        visit(items[i]);
+}
+
+bool HeapSnapshot::save(const std::string &path, Isolate *isolate)
+{
+    std::vector<Class *> classes;
+    std::map<Class *, uint32_t> classIndex;
+    std::vector<Object *> objects;
+    std::map<Object *, uint32_t> objectIndex;
+
+    auto addClass = [&](Class *cls) {
+        if (classIndex.emplace(cls, classes.size()).second)
+            classes.push_back(cls);
+    };
+    auto addObject = [&](uintptr_t &slot) {
+        Object *obj = reinterpret_cast<Object *>(slot);
+        if (obj != nullptr && objectIndex.emplace(obj, objects.size()).second)
+            objects.push_back(obj);
+    };
+
+    /* Roots first, objects are appended while the list is walked */
+    for (Class *cls : ClassCache::loadedClasses()) {
+        if (cls->classFile == nullptr || !isolate->state(cls)->initDone)
+            continue;
+        addClass(cls);
+        staticReferences(cls, isolate->state(cls)->staticFields, addObject);
+    }
+
+    std::map<Symbol *, Object *> literals = isolate->literalTable();
+    for (auto &literal : literals) {
+        uintptr_t slot = reinterpret_cast<uintptr_t>(literal.second);
+        addObject(slot);
+    }
+
+    for (size_t i = 0; i < objects.size(); i++) {
+        addClass(objects[i]->cls);
+        objectReferences(objects[i], addObject);
+    }
+
+    /* Copies get object indices + 1 in place of references, 0 is null */
+    auto relocate = [&](uintptr_t &slot) {
+        if (slot != 0)
+            slot = objectIndex[reinterpret_cast<Object *>(slot)] + 1;
+    };
+
+    std::vector<uint8_t> bytes;
+    ByteBuffer buffer(&bytes);
+    ByteWriter &out = buffer;
+    out.write((uint8_t *) SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    out.write(SNAPSHOT_VERSION);
+    /* Filled in below, truncated files are rejected by it */
+    out.write((uint32_t) 0);
+
+    out.write((uint32_t) classes.size());
+    for (Class *cls : classes) {
+        bool initialized = cls->classFile != nullptr &&
+                isolate->state(cls)->initDone;
+        writeString(out, cls->name);
+        out.write((uint8_t) initialized);
+        out.write(cls->staticFieldsLength);
+        out.write(cls->fieldsLength);
+        writeFields(out, cls);
+        if (!initialized)
+            continue;
+
+        uint8_t *original = isolate->state(cls)->staticFields;
+        std::vector<uint8_t> statics(original, original + cls->staticFieldsLength);
+        staticReferences(cls, statics.data(), relocate);
+        out.write(statics.data(), statics.size());
+    }
+
+    out.write((uint32_t) objects.size());
+    std::vector<uint8_t> copy;
+    for (Object *obj : objects) {
+        uint32_t size = payloadSize(obj);
+        copy.assign(reinterpret_cast<uint8_t *>(obj),
+                reinterpret_cast<uint8_t *>(obj) + obj->blockSize());
+        objectReferences(reinterpret_cast<Object *>(copy.data()), relocate);
+
+        out.write((uint32_t) classIndex[obj->cls]);
+        out.write(size);
+        out.write(reinterpret_cast<Object *>(copy.data())->fields, size);
+    }
+
+    out.write((uint32_t) literals.size());
+    for (auto &literal : literals) {
+        writeString(out, literal.first->str);
+        out.write((uint32_t) objectIndex[literal.second]);
+    }
+
+    uint32_t length = bytes.size() - SNAPSHOT_HEADER_SIZE;
+    for (size_t i = 0; i < 4; i++)
+        bytes[SNAPSHOT_HEADER_SIZE - 1 - i] = (uint8_t) (length >> (8 * i));
+
+    std::ofstream f(path.c_str(), std::ofstream::binary | std::ofstream::trunc);
+    f.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    return f.good();
+}
+
+bool HeapSnapshot::restore(const std::string &path, Isolate *isolate)
+{
+    std::ifstream f(path.c_str(), std::ifstream::binary);
+    if (!f)
+        return false;
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)),
+            std::istreambuf_iterator<char>());
+    MemoryByteReader in(bytes.data(), bytes.size());
+
+    uint8_t magic[sizeof(SNAPSHOT_MAGIC)];
+    in.read(magic, sizeof(magic));
+    if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 ||
+            in.read32() != SNAPSHOT_VERSION ||
+            in.read32() != in.remaining())
+        return false;
+
+    struct SavedClass
+    {
+        Class *cls;
+        bool initialized;
+        std::vector<uint8_t> statics;
+    };
+
+    /* Everything is read and checked before the first object is
+     * created; counts are bounded by the bytes left */
+    uint32_t classCount = in.read32();
+    if (classCount > in.remaining())
+        return false;
+    std::vector<SavedClass> classes(classCount);
+    for (SavedClass &state : classes) {
+        std::string name = readString(in);
+        state.initialized = in.read8();
+        uint16_t staticFieldsLength = in.read16();
+        uint16_t fieldsLength = in.read16();
+
+        if (!canRestore(name))
+            return false;
+        state.cls = ClassCache::getClass(name);
+        state.cls->link();
+        if (!readFields(in, state.cls) ||
+                state.cls->staticFieldsLength != staticFieldsLength ||
+                state.cls->fieldsLength != fieldsLength)
+            return false;
+
+        if (state.initialized) {
+            state.statics.resize(staticFieldsLength);
+            in.read(state.statics.data(), staticFieldsLength);
+        }
+    }
+
+    uint32_t objectCount = in.read32();
+    if (objectCount > in.remaining())
+        return false;
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> payloads(objectCount);
+    for (auto &payload : payloads) {
+        payload.first = in.read32();
+        uint32_t size = in.read32();
+        if (payload.first >= classes.size() || size > in.remaining())
+            return false;
+        payload.second.resize(size);
+        in.read(payload.second.data(), payload.second.size());
+    }
+
+    uint32_t literalCount = in.read32();
+    if (literalCount > in.remaining())
+        return false;
+    std::vector<std::pair<std::string, uint32_t>> literals(literalCount);
+    for (auto &literal : literals) {
+        literal.first = readString(in);
+        literal.second = in.read32();
+    }
+    if (in.overrun() || in.remaining() != 0)
+        return false;
+
+    std::vector<Object *> objects;
+    objects.reserve(payloads.size());
+    for (auto &payload : payloads) {
+        Class *cls = classes[payload.first].cls;
+        Object *obj;
+        if (cls->classFile != nullptr) {
+            obj = Object::newObject(cls);
+        } else {
+            int32_t length = 0;
+            if (payload.second.size() >= INTEGER_SIZE)
+                memcpy(&length, payload.second.data(), INTEGER_SIZE);
+            obj = Object::newArray(static_cast<ArrayClass *>(cls), length);
+        }
+
+        if (payloadSize(obj) != payload.second.size())
+            return false;
+        memcpy(obj->fields, payload.second.data(), payload.second.size());
+        objects.push_back(obj);
+    }
+
+    auto relocate = [&](uintptr_t &slot) {
+        slot = slot == 0 || slot > objects.size() ? 0 :
+                reinterpret_cast<uintptr_t>(objects[slot - 1]);
+    };
+
+    for (Object *obj : objects)
+        objectReferences(obj, relocate);
+
+    {
+        std::lock_guard<std::mutex> lock(Class::initLock);
+        for (SavedClass &state : classes) {
+            if (!state.initialized)
+                continue;
+            ClassState *classState = isolate->state(state.cls);
+            memcpy(classState->staticFields, state.statics.data(),
+                    state.statics.size());
+            staticReferences(state.cls, classState->staticFields, relocate);
+            classState->initStarted = true;
+            classState->initDone = true;
+        }
+    }
+
+    for (auto &literal : literals)
+        if (literal.second < objects.size())
+            isolate->addLiteral(Symbol::intern(literal.first), objects[literal.second]);
+
+    return true;
+}
@@ -0,0 +1,97 @@
+#include <cstdlib>
+#include <iostream>
+
+#include <jvm/isolate.h>
+#include <jvm/strings.h>
+
+static std::atomic<uint32_t> nextIsolateId{0};
+
+Isolate *Isolate::main()
+{
+    static Isolate *mainIsolate = new Isolate;
+    return mainIsolate;
+}
+
+Isolate *Isolate::current()
+{
+    Thread *thread = Thread::current;
+    return thread != nullptr ? thread->isolate : main();
+}
+
+Isolate::Isolate() :
+    id(nextIsolateId++)
+{
+    for (uint32_t i = 0; i < chunkCount; i++)
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+}
+
+Isolate::~Isolate()
+{
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        Slot *chunk = chunks[i].load(std::memory_order_relaxed);
+        if (chunk == nullptr)
+            continue;
+        for (uint32_t j = 0; j < chunkSize; j++) {
+            ClassState *classState = chunk[j].load(std::memory_order_relaxed);
+            if (classState == nullptr)
+                continue;
+            delete[] classState->staticFields;
+            delete classState;
+        }
+        delete[] chunk;
+    }
+}
+
+ClassState *Isolate::createState(Class *cls)
+{
+    /* Layout of static fields is known once linked */
+    cls->link();
+
+    std::lock_guard<std::mutex> guard(stateLock);
+
+    uint32_t chunkIndex = cls->id >> chunkBits;
+    if (chunkIndex >= chunkCount) {
+        std::cerr << "Too many classes for isolate state" << std::endl;
+        abort();
+    }
+
+    Slot *chunk = chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new Slot[chunkSize]();
+        chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    Slot &slot = chunk[cls->id & (chunkSize - 1)];
+    ClassState *classState = slot.load(std::memory_order_relaxed);
+    if (classState == nullptr) {
+        classState = new ClassState;
+        classState->staticFields = new uint8_t[cls->staticFieldsLength]();
+        slot.store(classState, std::memory_order_release);
+    }
+    return classState;
+}
+
+Object *Isolate::literal(Symbol *text)
+{
+    std::lock_guard<std::mutex> guard(literalsLock);
+
+    auto findIterator = literals.find(text);
+    if (findIterator != literals.end())
+        return findIterator->second;
+
+    Object *str = Strings::create(text->str);
+    literals[text] = str;
+    return str;
+}
+
+std::map<Symbol *, Object *> Isolate::literalTable()
+{
+    std::lock_guard<std::mutex> guard(literalsLock);
+    return literals;
+}
+
+void Isolate::addLiteral(Symbol *text, Object *str)
+{
+    std::lock_guard<std::mutex> guard(literalsLock);
+    literals[text] = str;
+}
@@ -1,15 +1,114 @@
 #include <jvm/jvm.h>
+#include <jvm/bootstrap.h>
+#include <jvm/class_path.h>
+#include <jvm/isolate.h>
+#include <jvm/shared_archive.h>
+#include <jvm/large_object_space.h>
+#include <jvm/escape_analysis.h>
+#include <jvm/prefetcher.h>
+#include <jvm/alloc_profiler.h>
+#include <jvm/exec_counters.h>
+#include <jvm/safepoint.h>
+#include <jvm/scheduler.h>
+#include <jvm/strings.h>
 #include <class/java_opcodes.h>
 #include <io/file_byte_reader.h>
+#include <io/memory_byte_reader.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <new>
 
 Class *ClassLoader::loadClass(std::string path)
 {
-    FileByteReader fr(path + ".class");
+    ClassFile *builtIn = Bootstrap::find(path);
+    if (builtIn != nullptr)
+        return loadClass(builtIn);
+
+    ClassFile *shared = SharedArchive::load(path);
+    if (shared != nullptr)
+        return loadClass(shared);
+
+    if (SharedArchive::recording) {
+        const std::vector<uint8_t> &bytes = SharedArchive::record(path);
+        if (!bytes.empty()) {
+            MemoryByteReader mr(bytes.data(), bytes.size());
+            return loadClass(&mr);
+        }
+    }
+
+    size_t length;
+    std::vector<uint8_t> buffer;
+    const uint8_t *data = ClassPath::find(path, length, buffer);
+    if (data != nullptr) {
+        MemoryByteReader mr(data, length);
+        return loadClass(&mr);
+    }
+
+    if (!ClassPath::empty())
+        return nullptr;
 
+    FileByteReader fr(path + ".class");
+    if (!fr.isOpen())
+        return nullptr;
     return loadClass(&fr);
 }
 
+bool ClassLoader::canLoad(const std::string &path)
+{
+    return Bootstrap::find(path) != nullptr ||
+            SharedArchive::contains(path) ||
+            ClassPath::contains(path) ||
+            (ClassPath::empty() &&
+             std::ifstream((path + ".class").c_str()).good());
+}
+
+/* True if index names a CONSTANT_Class entry with a Utf8 name */
+static bool isClassEntry(ClassFile &cf, uint16_t index)
+{
+    if (index == 0 || index > cf.constantPool.size() ||
+            cf.constantPool[index - 1]->tag != CONSTANT_Class)
+        return false;
+    uint16_t name = static_cast<IndexInfo *>(cf.constantPool[index - 1])->index;
+    return name != 0 && name <= cf.constantPool.size() &&
+            cf.constantPool[name - 1]->tag == CONSTANT_Utf8;
+}
+
+Class *ClassLoader::defineClass(const uint8_t *data, size_t length)
+{
+    static const uint8_t magic[] = {0xCA, 0xFE, 0xBA, 0xBE};
+    if (data == nullptr || length < sizeof(magic) ||
+            memcmp(data, magic, sizeof(magic)) != 0)
+        return nullptr;
+
+    MemoryByteReader mr(data, length);
+    ClassFile *cf = new ClassFile;
+    *cf = ClassFile::read(&mr);
+    if (mr.overrun() || !isClassEntry(*cf, cf->thisClass) ||
+            (cf->superClass != 0 && !isClassEntry(*cf, cf->superClass))) {
+        delete cf;
+        return nullptr;
+    }
+
+    Class *cls = defineClass(cf);
+    if (cls == nullptr)
+        delete cf;
+    return cls;
+}
+
+Class *ClassLoader::defineClass(ClassFile *cf)
+{
+    Class *cls = loadClass(cf);
+    cls->name = cf->getIndexName(cf->thisClass);
+    if (!ClassCache::define(cls->name, cls)) {
+        delete cls;
+        return nullptr;
+    }
+    return cls;
+}
+
 Class *ClassLoader::loadClass(ClassFile *cf)
 {
     return new Class(cf);
@@ -22,64 +121,100 @@ Class *ClassLoader::loadClass(ByteReader *br)
     return ClassLoader::loadClass(cf);
 }
 
-Class::Class() {
+static std::atomic<uint32_t> nextClassId{0};
+
+Class::Class() :
+    id(nextClassId++)
+{
     super = ClassCache::getClass("java/lang/Object");
+    linked = true;
 }
 
 Class::Class(ClassFile *classFile) :
-    classFile(classFile)
+    id(nextClassId++), classFile(classFile)
+{
+}
+
+void Class::link()
+{
+    if (!linked.load(std::memory_order_acquire))
+        linkClass();
+}
+
+/* Racing threads resolve to the same class, either store is fine */
+Class *Class::resolveClass(uint16_t index)
+{
+    Class *cls = resolvedClasses[index - 1].load(std::memory_order_acquire);
+    if (cls == nullptr) {
+        cls = ClassCache::getClass(classFile->getIndexName(index));
+        resolvedClasses[index - 1].store(cls, std::memory_order_release);
+    }
+    return cls;
+}
+
+void Class::linkClass()
 {
+    std::lock_guard<std::recursive_mutex> guard(linkLock);
+    if (linked.load(std::memory_order_relaxed))
+        return;
+
     uint16_t superIndex = classFile->superClass;
     if (superIndex != 0) {
         std::string superPath = classFile->getIndexName(superIndex);
         super = ClassCache::getClass(superPath);
-    } else {
-        super = nullptr;
-    }
-
-    if (super != nullptr)
+        super->link();
         fieldsLength = super->fieldsLength;
+    }
 
-    uint16_t totalFieldsCount = classFile->fields.size();
-    uint16_t staticFieldsCount = 0, fieldsCount = 0;
-    for (size_t i = 0; i < totalFieldsCount; i++) {
-        MemberInfo *fieldInfo = classFile->fields[i];
-        std::string fieldName = classFile->getUtf8(fieldInfo->nameIndex),
-                fieldDescriptor = classFile->getUtf8(fieldInfo->descriptorIndex);
-        descriptors[fieldName] = fieldDescriptor;
-        if (fieldInfo->accessFlags & ACC_STATIC) {
-            fieldOffset[fieldName] = staticFieldsLength;
-            staticFieldsLength += fieldSize(fieldDescriptor);
-            staticFieldNames.push_back(fieldName);
-            staticFieldsCount++;
+    size_t poolSize = classFile->constantPool.size();
+    resolvedClasses = new std::atomic<Class *>[poolSize];
+    for (size_t i = 0; i < poolSize; i++)
+        resolvedClasses[i].store(nullptr, std::memory_order_relaxed);
+
+    fields.reserve(classFile->fields.size());
+    for (MemberInfo *fieldInfo : classFile->fields) {
+        Field field;
+        field.name = classFile->getSymbol(fieldInfo->nameIndex);
+        field.descriptor = classFile->getSymbol(fieldInfo->descriptorIndex);
+        field.type = field.descriptor->str[0];
+        field.isStatic = fieldInfo->accessFlags & ACC_STATIC;
+        if (field.isStatic) {
+            field.offset = staticFieldsLength;
+            staticFieldsLength += fieldSize(field.descriptor->str);
         } else {
-            fieldOffset[fieldName] = fieldsLength;
-            fieldsLength += fieldSize(fieldDescriptor);
-            fieldNames.push_back(fieldName);
-            fieldsCount++;
+            field.offset = fieldsLength;
+            fieldsLength += fieldSize(field.descriptor->str);
         }
+        fields.push_back(field);
+    }
+    std::sort(fields.begin(), fields.end(),
+            [](const Field &a, const Field &b) { return a.name < b.name; });
+
+    static Symbol *initName = Symbol::intern("<clinit>"),
+            *initDescriptor = Symbol::intern("()V");
+
+    std::vector<std::pair<SymbolPair, MemberInfo *>> sorted;
+    for (MemberInfo *methodMember : classFile->methods)
+        sorted.push_back(std::make_pair(SymbolPair(
+                classFile->getSymbol(methodMember->nameIndex),
+                classFile->getSymbol(methodMember->descriptorIndex)),
+                methodMember));
+    std::sort(sorted.begin(), sorted.end());
+
+    methodsCount = sorted.size();
+    methods = new MethodEntry[methodsCount];
+    for (uint16_t i = 0; i < methodsCount; i++) {
+        methods[i].name = sorted[i].first.first;
+        methods[i].descriptor = sorted[i].first.second;
+        methods[i].info = sorted[i].second;
     }
 
-    /* Zero-initialization of fields */
-    staticFields = new uint8_t[staticFieldsLength]();
-
-    for (MemberInfo* methodMember : classFile->methods) {
-        uint16_t nameIndex = methodMember->nameIndex;
-        uint16_t descriptorIndex = methodMember->descriptorIndex;
-
-        std::string methodName = classFile->getUtf8(nameIndex);
-        std::string methodDescriptor =
-                classFile->getUtf8(descriptorIndex);
-        std::string combined = methodName + ':' + methodDescriptor;
-        Method *method = new Method(this, methodMember);
-
-        methods[combined] = method;
+    /* The only method built eagerly, initialization follows linking */
+    classInit = findMethod(initName, initDescriptor);
+    if (classInit != nullptr)
+        classInit->isInit = true;
 
-        if (classInit == nullptr && combined == "<clinit>:()V") {
-            method->isInit = true;
-            classInit = method;
-        }
-    }
+    linked.store(true, std::memory_order_release);
 }
 
 Object *Class::newObject()
@@ -109,42 +244,37 @@ Object *Object::newObject(Class *cls)
     return newObjectBlock(cls, sizeof(Object) + cls->fieldsLength - 1);
 }
 
-Object *Object::newArray(ArrayClass *cls, uint32_t length)
+uint8_t ArrayClass::itemSize()
 {
-    uint8_t itemSize;
+    if (!arrayOfPrimitives)
+        return OBJECT_SIZE;
 
-    if (cls->arrayOfPrimitives) {
-        switch (cls->arrayBase.primitiveBase) {
-            case T_BOOLEAN:
-                itemSize = BOOLEAN_SIZE;
-                break;
-            case T_CHAR:
-                itemSize = CHAR_SIZE;
-                break;
-            case T_FLOAT:
-                itemSize = FLOAT_SIZE;
-                break;
-            case T_DOUBLE:
-                itemSize = DOUBLE_SIZE;
-                break;
-            case T_BYTE:
-                itemSize = BYTE_SIZE;
-                break;
-            case T_SHORT:
-                itemSize = SHORT_SIZE;
-                break;
-            case T_INT:
-                itemSize = INTEGER_SIZE;
-                break;
-            case T_LONG:
-                itemSize = LONG_SIZE;
-                break;
-        }
-    } else
-        itemSize = OBJECT_SIZE;
+    switch (arrayBase.primitiveBase) {
+        case T_BOOLEAN:
+            return BOOLEAN_SIZE;
+        case T_CHAR:
+            return CHAR_SIZE;
+        case T_FLOAT:
+            return FLOAT_SIZE;
+        case T_DOUBLE:
+            return DOUBLE_SIZE;
+        case T_BYTE:
+            return BYTE_SIZE;
+        case T_SHORT:
+            return SHORT_SIZE;
+        case T_INT:
+            return INTEGER_SIZE;
+        case T_LONG:
+            return LONG_SIZE;
+        default:
+            return 0;
+    }
+}
 
+Object *Object::newArray(ArrayClass *cls, uint32_t length)
+{
     // {int a.length, a[0], a[1], ..., a[a.length - 1]}
-    uint32_t totalLength = itemSize * length + INTEGER_SIZE;
+    uint32_t totalLength = cls->itemSize() * length + INTEGER_SIZE;
 
     Object *array  = newObjectBlock(cls, sizeof(Object) + totalLength - 1);
     *reinterpret_cast<int32_t *>(array->fields) = length;
@@ -154,17 +284,53 @@ Object *Object::newArray(ArrayClass *cls, uint32_t length)
 
 Object *Object::newObjectBlock(Class *cls, uint32_t size)
 {
-    uint8_t *objBuffer = new uint8_t[size]();
+    uint8_t *objBuffer;
+
+    /* Fresh mappings are zero-filled, no need to clear them */
+    if (LargeObjectSpace::isLarge(size)) {
+        objBuffer = LargeObjectSpace::allocate(size);
+        if (objBuffer == nullptr)
+            throw std::bad_alloc();
+    } else
+        objBuffer = new uint8_t[size]();
+
+    if (AllocationProfiler::enabled)
+        AllocationProfiler::record(cls, size);
+    Isolate::current()->allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
     Object *obj = reinterpret_cast<Object *>(objBuffer);
     obj->cls = cls;
     return obj;
 }
 
+Object *Object::newLocalObject(Class *cls, StackArena *arena)
+{
+    uint32_t size = sizeof(Object) + cls->fieldsLength - 1;
+    uint8_t *objBuffer = arena->allocate(size);
+
+    if (AllocationProfiler::enabled)
+        AllocationProfiler::record(cls, size);
+
+    Object *obj = reinterpret_cast<Object *>(objBuffer);
+    obj->cls = cls;
+    return obj;
+}
+
+uint32_t Object::blockSize()
+{
+    if (cls->classFile != nullptr)
+        return sizeof(Object) + cls->fieldsLength - 1;
+
+    ArrayClass *arrayClass = static_cast<ArrayClass *>(cls);
+    uint32_t length = *reinterpret_cast<int32_t *>(fields);
+    return sizeof(Object) + arrayClass->itemSize() * length + INTEGER_SIZE - 1;
+}
+
 static std::string primitiveArrays[] =
     {"",   "",   "",   "",   "[Z", "[C",
      "[F", "[D", "[B", "[S", "[I", "[L"};
 
-uint8_t Class::fieldSize(std::string descriptor)
+uint8_t Class::fieldSize(const std::string &descriptor)
 {
     switch (descriptor[0]) {
         case 'B':
@@ -191,26 +357,195 @@ uint8_t Class::fieldSize(std::string descriptor)
     }
 }
 
-Method *Class::getMethod(std::string name, std::string descriptor)
+Field *Class::findField(Symbol *name)
 {
-    std::string combined = name + ':' + descriptor;
-
-    auto findIterator = methods.find(combined);
-    if (findIterator != methods.end())
-        return (*findIterator).second;
+    link();
+    auto findIterator = std::lower_bound(fields.begin(), fields.end(), name,
+            [](const Field &field, Symbol *name) { return field.name < name; });
+    if (findIterator != fields.end() && findIterator->name == name)
+        return &*findIterator;
 
     return nullptr;
 }
 
-std::map<std::string, Class*> ClassCache::classMap;
+Method *Class::getMethod(Symbol *name, Symbol *descriptor)
+{
+    link();
+    return findMethod(name, descriptor);
+}
+
+Method *Class::findMethod(Symbol *name, Symbol *descriptor)
+{
+    SymbolPair key(name, descriptor);
+    MethodEntry *entry = std::lower_bound(methods, methods + methodsCount, key,
+            [](const MethodEntry &entry, const SymbolPair &key) {
+        return SymbolPair(entry.name, entry.descriptor) < key;
+    });
+    if (entry == methods + methodsCount || entry->name != name ||
+            entry->descriptor != descriptor)
+        return nullptr;
+
+    Method *method = entry->method.load(std::memory_order_acquire);
+    if (method != nullptr)
+        return method;
+
+    std::lock_guard<std::recursive_mutex> guard(linkLock);
+    method = entry->method.load(std::memory_order_relaxed);
+    if (method == nullptr) {
+        method = new Method(this, entry->info);
+        entry->method.store(method, std::memory_order_release);
+    }
+    return method;
+}
+
+Method *Class::getMethod(const std::string &name, const std::string &descriptor)
+{
+    return getMethod(Symbol::intern(name), Symbol::intern(descriptor));
+}
+
+std::mutex Class::initLock;
+std::recursive_mutex Class::linkLock;
+std::condition_variable Class::initCond;
+
+std::atomic<ClassCache::Table *> ClassCache::table{new ClassCache::Table(256)};
+std::mutex ClassCache::tableLock;
+std::map<std::string, std::thread::id> ClassCache::loading;
+std::condition_variable ClassCache::loadedCond;
+thread_local ClassCache::Entry *ClassCache::frontCache[ClassCache::frontCacheSize];
+
+ClassCache::Table::Table(size_t capacity) :
+    mask(capacity - 1), used(0),
+    slots(new std::atomic<Entry *>[capacity]())
+{
+}
+
+ClassCache::Entry *ClassCache::Table::find(const std::string &name, size_t hash)
+{
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        Entry *entry = slots[i].load(std::memory_order_acquire);
+        if (entry == nullptr)
+            return nullptr;
+        if (entry->hash == hash && entry->name == name)
+            return entry;
+    }
+}
+
+void ClassCache::Table::insert(Entry *entry)
+{
+    size_t i = entry->hash & mask;
+    while (slots[i].load(std::memory_order_relaxed) != nullptr)
+        i = (i + 1) & mask;
+    slots[i].store(entry, std::memory_order_release);
+    used++;
+}
 
-Class *ClassCache::getClass(std::string path)
+ClassCache::Entry *ClassCache::lookup(const std::string &path, size_t hash)
 {
-    auto findIterator = classMap.find(path);
-    if (findIterator != classMap.end())
-        return (*findIterator).second;
+    Entry *&cached = frontCache[hash & (frontCacheSize - 1)];
+    if (cached != nullptr && cached->hash == hash && cached->name == path)
+        return cached;
+
+    Entry *entry = table.load(std::memory_order_acquire)->find(path, hash);
+    if (entry != nullptr)
+        cached = entry;
+    return entry;
+}
+
+Class *ClassCache::findLoaded(const std::string &path)
+{
+    Entry *entry = lookup(path, std::hash<std::string>()(path));
+    return entry != nullptr ? entry->cls : nullptr;
+}
 
-    Class *loadedClass;
+std::vector<Class *> ClassCache::loadedClasses()
+{
+    std::lock_guard<std::mutex> lock(tableLock);
+
+    std::vector<Class *> classes;
+    Table *current = table.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= current->mask; i++) {
+        Entry *entry = current->slots[i].load(std::memory_order_relaxed);
+        if (entry != nullptr)
+            classes.push_back(entry->cls);
+    }
+    return classes;
+}
+
+bool ClassCache::define(const std::string &path, Class *cls)
+{
+    size_t hash = std::hash<std::string>()(path);
+    {
+        std::lock_guard<std::mutex> lock(tableLock);
+        if (table.load(std::memory_order_relaxed)->find(path, hash) != nullptr ||
+                loading.find(path) != loading.end())
+            return false;
+        loading[path] = std::this_thread::get_id();
+    }
+
+    publish(path, hash, cls);
+    return true;
+}
+
+Class *ClassCache::getClass(const std::string &path)
+{
+    size_t hash = std::hash<std::string>()(path);
+
+    Entry *entry = lookup(path, hash);
+    if (entry != nullptr)
+        return entry->cls;
+
+    {
+        std::unique_lock<std::mutex> lock(tableLock);
+        while (true) {
+            entry = table.load(std::memory_order_relaxed)->find(path, hash);
+            if (entry != nullptr)
+                return entry->cls;
+
+            auto loader = loading.find(path);
+            if (loader == loading.end())
+                break;
+            /* Class is its own ancestor */
+            if (loader->second == std::this_thread::get_id())
+                return nullptr;
+            /* Another thread parses it, wait instead of parsing twice */
+            loadedCond.wait(lock);
+        }
+        loading[path] = std::this_thread::get_id();
+    }
+
+    Class *loadedClass = load(path);
+    publish(path, hash, loadedClass);
+    if (Prefetcher::enabled.load(std::memory_order_relaxed))
+        Prefetcher::classLoaded(loadedClass);
+
+    return loadedClass;
+}
+
+void ClassCache::publish(const std::string &path, size_t hash, Class *cls)
+{
+    std::lock_guard<std::mutex> lock(tableLock);
+
+    Table *current = table.load(std::memory_order_relaxed);
+    if ((current->used + 1) * 2 > current->mask + 1) {
+        /* Old table stays alive, readers may still walk it */
+        Table *grown = new Table((current->mask + 1) * 2);
+        for (size_t i = 0; i <= current->mask; i++) {
+            Entry *entry = current->slots[i].load(std::memory_order_relaxed);
+            if (entry != nullptr)
+                grown->insert(entry);
+        }
+        table.store(grown, std::memory_order_release);
+        current = grown;
+    }
+
+    current->insert(new Entry{path, hash, cls});
+    loading.erase(path);
+    loadedCond.notify_all();
+}
+
+Class *ClassCache::load(const std::string &path)
+{
+    Class *loadedClass = nullptr;
 
     if (path[0] == '[') {
         std::string className;
@@ -232,13 +567,21 @@ Class *ClassCache::getClass(std::string path)
         loadedClass = ClassLoader::loadClass(path);
     }
 
-    classMap[path] = loadedClass;
+    /* Like an unsatisfied link, there is no NoClassDefFoundError to throw */
+    if (loadedClass == nullptr) {
+        std::cout.flush();
+        std::cerr << "Class not found: " << path << std::endl;
+        std::exit(1);
+    }
 
+    loadedClass->name = path;
     return loadedClass;
 }
 
 Method::Method(Class *owner, MemberInfo *info) :
-    owner(owner), methodInfo(info)
+    owner(owner), methodInfo(info),
+    name(owner->classFile->getSymbol(info->nameIndex)),
+    descriptor(owner->classFile->getSymbol(info->descriptorIndex))
 {
     for (AttributeInfo *attr : info->attributes) {
         uint16_t nameIndex = attr->nameIndex;
@@ -254,35 +597,42 @@ Method::Method(Class *owner, MemberInfo *info) :
     }
 
     size_t argIndex = 1;
-    std::string descriptor =
-            owner->classFile->getUtf8(info->descriptorIndex);
-    while (descriptor[argIndex] != ')')
-        if (descriptor[argIndex] == '[' ||
-                descriptor[argIndex] == 'L') {
-            size_t argEnd = descriptor.find(';', argIndex) + 1;
-            argDescriptors.push_back(descriptor.substr(argIndex, argEnd - argIndex));
-            argIndex = argEnd;
-        } else {
-            char argDescriptor = descriptor[argIndex++];
-            argDescriptors.push_back(std::string(1, argDescriptor));
-            if (argDescriptor == 'J' || argDescriptor == 'D') {
-                argDescriptors.push_back(argDescriptor + "+");
-            }
-        }
-    returnDescriptor = descriptor.substr(++argIndex, descriptor.length() - 1);
+    const std::string &descriptor = this->descriptor->str;
+    while (descriptor[argIndex] != ')') {
+        char type = descriptor[argIndex];
+        argTypes += type;
+        argSlots += (type == 'J' || type == 'D') ? 2 : 1;
+
+        while (descriptor[argIndex] == '[')
+            argIndex++;
+        if (descriptor[argIndex] == 'L')
+            argIndex = descriptor.find(';', argIndex);
+        argIndex++;
+    }
+    returnType = descriptor[argIndex + 1];
 
-    codeLength = codeAttr->codeLength;
-    code = codeAttr->code;
+    nativeCode = Natives::find(
+            owner->classFile->getIndexName(owner->classFile->thisClass),
+            name->str, descriptor);
+
+    /* Native and abstract methods have no code */
+    if (codeAttr != nullptr) {
+        codeLength = codeAttr->codeLength;
+        code = codeAttr->code;
+    } else {
+        codeLength = 0;
+        code = nullptr;
+    }
 }
 
-Frame::Frame(Method *m) :
+Frame::Frame(Method *m, intptr_t *slots) :
     owner(m), pc(0), stackTop(0)
 {
     pc = stackTop = 0;
     maxStack = m->codeAttr->maxStack;
     maxLocals = m->codeAttr->maxLocals;
-    stack = new intptr_t[m->codeAttr->maxStack]();
-    locals = new intptr_t[m->codeAttr->maxLocals]();
+    stack = slots;
+    locals = slots + maxStack;
     code = m->code;
 
     /* Used to mark references and wide values (long, double) on stack
@@ -292,41 +642,134 @@ Frame::Frame(Method *m) :
     */
 }
 
-Frame::~Frame()
+thread_local Thread *Thread::current = nullptr;
+
+static std::atomic<uint32_t> nextLockId{1};
+
+Thread::Thread() :
+    Thread(Isolate::main())
+{
+}
+
+Thread::Thread(Isolate *isolate) :
+    lockId(nextLockId++), isolate(isolate), quantumLeft(Scheduler::quantum)
+{
+}
+
+void Thread::invoke(Method *m, const std::vector<intptr_t> &args)
+{
+    prepare(m, args);
+    runLoop();
+}
+
+void Thread::prepare(Method *m, const std::vector<intptr_t> &args)
 {
-    delete stack;
-    delete locals;
+    prepare(m, args.data(), args.size());
 }
 
-void Thread::invoke(Method *m)
+void Thread::prepare(Method *m, const intptr_t *args, size_t count)
 {
     pushMethod(m);
+    for (size_t i = 0; i < count; i++)
+        top->locals[i] = args[i];
+
+    uint16_t accessFlags = m->methodInfo->accessFlags;
+    if (accessFlags & ACC_SYNCHRONIZED) {
+        entryFrame = top;
+        if (accessFlags & ACC_STATIC)
+            entryLock = &isolate->state(m->owner)->lockWord;
+        else
+            entryLock = &reinterpret_cast<Object *>(top->locals[0])->lockWord;
+    }
+
     if (!initStack.empty())
         pushInit();
+}
+
+intptr_t Thread::call(Method *m, const intptr_t *args, size_t count)
+{
+    /* Initialized classes skip initLock altogether */
+    if (!isolate->state(m->owner)->initDone)
+        prepareInit(m->owner);
+
+    ret = 0;
+    prepare(m, args, count);
     runLoop();
+    return ret;
+}
+
+intptr_t *Thread::beginBatch(Method *m)
+{
+    if (!isolate->state(m->owner)->initDone)
+        initialize(m->owner);
+
+    pushMethod(m);
+    batchFrame = top;
+    rowMark = arena.mark();
+
+    /* Rows run back to back, the thread stays out of its safe region */
+    current = this;
+    Safepoint::leaveSafeRegion(this);
+    return top->locals;
+}
+
+intptr_t Thread::runRow()
+{
+    batchFrame->pc = 0;
+    batchFrame->stackTop = 0;
+    ret = 0;
+    execute();
+
+    /* Objects local to the row go, the frame stays */
+    arena.release(rowMark);
+    return ret;
+}
+
+void Thread::endBatch()
+{
+    Safepoint::enterSafeRegion(this);
+    current = nullptr;
+
+    popFrame();
+    batchFrame = nullptr;
 }
 
 void Thread::pushMethod(Method *m)
 {
+    if (ExecutionCounters::enabled)
+        ExecutionCounters::invoked(m);
     Frame *startFrame = newFrame(m);
     pushFrame(startFrame);
 }
 
 Frame *Thread::newFrame(Method *m)
 {
-    return new Frame(m);
+    /* Frame and its slots come from the arena and go with the frame */
+    StackArena::Mark mark = arena.mark();
+    size_t slots = m->codeAttr->maxStack + m->codeAttr->maxLocals;
+    uint8_t *block = arena.allocate(sizeof(Frame) + slots * sizeof(intptr_t));
+
+    Frame *f = new (block) Frame(m, reinterpret_cast<intptr_t *>(block + sizeof(Frame)));
+    f->arenaMark = mark;
+    return f;
 }
 
 void Thread::popFrame()
 {
-    Frame *f = top->prev;
-    delete top;
-    top = f;
+    Frame *popped = top;
+    if (popped->monitor != nullptr)
+        Monitor::exit(*popped->monitor, this);
+
+    /* Profiler signals may walk the chain at any point */
+    top = popped->prev;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    arena.release(popped->arenaMark);
 }
 
 void Thread::pushFrame(Frame *f)
 {
     f->prev = top;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
     top = f;
 }
 
@@ -348,43 +791,267 @@ void Thread::saveFrame()
     prev = top;
 }
 
-void Thread::prepareInit(Class *c)
+bool Thread::prepareInit(Class *c)
 {
-    if (c->initStarted || c->initDone)
+    /* Released after initLock, the thread may wait for a safepoint */
+    SafeRegion region(this);
+    std::unique_lock<std::mutex> lock(Class::initLock);
+    return prepareInit(c, lock);
+}
+
+void Thread::initialize(Class *c)
+{
+    c->link();
+    if (!prepareInit(c))
         return;
-    c->initStarted = true;
 
-    if (c->classInit != nullptr)
-        initStack.push(c->classInit);
-    else
-        c->initDone = true;
+    pushInit();
+    if (top != nullptr)
+        runLoop();
+}
+
+bool Thread::prepareInit(Class *c, std::unique_lock<std::mutex> &lock)
+{
+    /* Initialization by another thread must complete first */
+    while (true) {
+        ClassState *busy = nullptr;
+        for (Class *s = c; s != nullptr; s = s->super) {
+            ClassState *state = isolate->state(s);
+            if (state->initStarted && !state->initDone && state->initThread != this)
+                busy = state;
+        }
+        if (busy == nullptr)
+            break;
+
+        /* Green threads must not block their worker, finishInit wakes them */
+        if (Scheduler::active) {
+            if (std::find(busy->initWaiters.begin(), busy->initWaiters.end(),
+                    this) == busy->initWaiters.end())
+                busy->initWaiters.push_back(this);
+            blocked = true;
+            return false;
+        }
+        Class::initCond.wait(lock);
+    }
 
-    if (c->super != nullptr)
-        prepareInit(c->super);
+    /* Superclass is pushed later, so it is initialized first */
+    bool pushed = false;
+    for (; c != nullptr; c = c->super) {
+        ClassState *state = isolate->state(c);
+        if (state->initStarted || state->initDone)
+            break;
+        if (!pushed)
+            initStack.push(nullptr);
+        state->initStarted = true;
+        state->initThread = this;
+        initStack.push(c);
+        pushed = true;
+    }
+    return pushed;
 }
 
 void Thread::pushInit()
 {
-    Method *initMethod = initStack.top();
-    initStack.pop();
+    /* The batch ends at its marker, older batches wait for their
+     * <clinit> frames to return */
+    while (!initStack.empty()) {
+        Class *c = initStack.top();
+        initStack.pop();
+        if (c == nullptr)
+            return;
 
-    pushMethod(initMethod);
+        if (c->classInit != nullptr) {
+            pushMethod(c->classInit);
+            return;
+        }
+        finishInit(c);
+    }
 }
 
-void Thread::runLoop()
+bool Thread::enterInit()
 {
+    saveFrame();
+    if (blocked)
+        return false;
+    pushInit();
+    loadFrame();
+    return true;
+}
+
+void Thread::finishInit(Class *c)
+{
+    std::lock_guard<std::mutex> lock(Class::initLock);
+    ClassState *state = isolate->state(c);
+    state->initDone = true;
+    state->initThread = nullptr;
+    Class::initCond.notify_all();
+    for (Thread *waiter : state->initWaiters)
+        Scheduler::wake(waiter);
+    state->initWaiters.clear();
+}
+
+LockWord *Thread::methodLock()
+{
+    uint16_t accessFlags = resolvedMethod->methodInfo->accessFlags;
+    if (!(accessFlags & ACC_SYNCHRONIZED))
+        return nullptr;
+
+    if (accessFlags & ACC_STATIC)
+        return &isolate->state(resolvedMethod->owner)->lockWord;
+    uint16_t receiver = stackTop - resolvedMethod->argSlots - 1;
+    return &reinterpret_cast<Object *>(stack[receiver])->lockWord;
+}
+
+bool Thread::enterMonitor(LockWord &word)
+{
+    if (!Scheduler::active) {
+        Monitor::enter(word, this);
+        return true;
+    }
+    if (Monitor::enterGreen(word, this))
+        return true;
+    blocked = true;
+    return false;
+}
+
+bool Thread::poll()
+{
+    if (Safepoint::requested.load(std::memory_order_relaxed)) {
+        saveFrame();
+        Safepoint::block(this);
+    }
+    return preempt();
+}
+
+bool Thread::preempt()
+{
+    if (!Scheduler::active || --quantumLeft != 0)
+        return false;
+    quantumLeft = Scheduler::quantum;
+    saveFrame();
+    return true;
+}
+
+bool Thread::jump()
+{
+    int16_t branch = (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
+    pc += branch;
+    /* Loops are where a green thread gets switched out */
+    return branch < 0 && poll();
+}
+
+bool Thread::invokeResolved()
+{
+    if (resolvedMethod->nativeCode != nullptr)
+        return invokeNative();
+    /* Native method nobody registered, there are no exceptions to throw */
+    if (resolvedMethod->code == nullptr) {
+        std::cout.flush();
+        std::cerr << "Unsatisfied link: " << resolvedMethod->owner->name
+                  << '.' << resolvedMethod->name->str
+                  << resolvedMethod->descriptor->str << std::endl;
+        std::exit(1);
+    }
+
+    LockWord *lock = methodLock();
+    if (lock != nullptr && !enterMonitor(*lock)) {
+        saveFrame();
+        return false;
+    }
+
+    pc += 3;
+    saveFrame();
+    pushMethod(resolvedMethod);
+    loadFrame();
+    loadArgs();
+    top->monitor = lock;
+    return !poll();
+}
+
+bool Thread::invokeNative()
+{
+    Method *m = resolvedMethod;
+    uint16_t argsLength = m->argSlots;
+    if (instanceMethod)
+        argsLength++;
+
+    stackTop -= argsLength;
+    pc += 3;
+    saveFrame();
+    intptr_t result = m->nativeCode(this, &stack[stackTop]);
+
+    /* Call is repeated when the thread is resumed */
+    if (blocked) {
+        stackTop += argsLength;
+        pc -= 3;
+        saveFrame();
+        return false;
+    }
+    if (ExecutionCounters::enabled)
+        ExecutionCounters::invoked(m);
+
+    switch (m->returnType) {
+        case 'V':
+            break;
+        case 'J':
+        case 'D':
+            *(int64_t *) &stack[stackTop] = result;
+            stackTop += 2;
+            break;
+        default:
+            stack[stackTop++] = result;
+            break;
+    }
+    return true;
+}
+
+bool Thread::runLoop()
+{
+    current = this;
+    blocked = false;
+
+    Safepoint::leaveSafeRegion(this);
+    bool finished = execute();
+    Safepoint::enterSafeRegion(this);
+
+    /* Green workers run other tasks, this one may be deleted */
+    current = nullptr;
+    return finished;
+}
+
+bool Thread::execute()
+{
+    if (entryLock != nullptr) {
+        if (!enterMonitor(*entryLock))
+            return false;
+        entryFrame->monitor = entryLock;
+        entryLock = nullptr;
+    }
+
     loadFrame();
     while (true) {
         saveFrame(); // save for debug
-        Debug::debugCallStack(top);
+        if (Debug::trace)
+            Debug::debugCallStack(top);
+        if (ExecutionCounters::enabled)
+            ExecutionCounters::instruction(top->owner, code[pc]);
         switch (code[pc]) {
         case opcodes::BIPUSH:
-            stack[stackTop++] = code[pc + 1];
+            stack[stackTop++] = (int8_t) code[pc + 1];
             pc += 2;
             break;
         case opcodes::SIPUSH:
             stack[stackTop++] =
-                    (code[pc + 1] << 8) | code[pc + 2];
+                    (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
+            pc += 3;
+            break;
+        case opcodes::LDC:
+            loadConstant(code[pc + 1]);
+            pc += 2;
+            break;
+        case opcodes::LDC_W:
+        case opcodes::LDC2_W:
+            loadConstant((code[pc + 1] << 8) | code[pc + 2]);
             pc += 3;
             break;
         case opcodes::ICONST_M1:
@@ -397,6 +1064,12 @@ void Thread::runLoop()
             stack[stackTop++] =
                     code[pc++] - opcodes::ICONST_0;
             break;
+        /* Longs take two slots, the value is kept from the first one */
+        case opcodes::LCONST_0:
+        case opcodes::LCONST_1:
+            *(int64_t *) &stack[stackTop] = code[pc++] - opcodes::LCONST_0;
+            stackTop += 2;
+            break;
         case opcodes::ILOAD:
         case opcodes::ALOAD:
             stack[stackTop++] = locals[code[++pc]];
@@ -416,6 +1089,19 @@ void Thread::runLoop()
             stack[stackTop++] =
                     locals[code[pc++] - opcodes::ALOAD_0];
             break;
+        case opcodes::LLOAD:
+            *(int64_t *) &stack[stackTop] = *(int64_t *) &locals[code[++pc]];
+            stackTop += 2;
+            pc++;
+            break;
+        case opcodes::LLOAD_0:
+        case opcodes::LLOAD_1:
+        case opcodes::LLOAD_2:
+        case opcodes::LLOAD_3:
+            *(int64_t *) &stack[stackTop] =
+                    *(int64_t *) &locals[code[pc++] - opcodes::LLOAD_0];
+            stackTop += 2;
+            break;
         case opcodes::ISTORE:
         case opcodes::ASTORE:
             locals[code[++pc]] = stack[--stackTop];
@@ -435,6 +1121,19 @@ void Thread::runLoop()
             locals[code[pc++] - opcodes::ASTORE_0] =
                     stack[--stackTop];
             break;
+        case opcodes::LSTORE:
+            stackTop -= 2;
+            *(int64_t *) &locals[code[++pc]] = *(int64_t *) &stack[stackTop];
+            pc++;
+            break;
+        case opcodes::LSTORE_0:
+        case opcodes::LSTORE_1:
+        case opcodes::LSTORE_2:
+        case opcodes::LSTORE_3:
+            stackTop -= 2;
+            *(int64_t *) &locals[code[pc++] - opcodes::LSTORE_0] =
+                    *(int64_t *) &stack[stackTop];
+            break;
         case opcodes::IALOAD:
             loadIntArray();
             pc++;
@@ -451,28 +1150,61 @@ void Thread::runLoop()
             storeBoolArray();
             pc++;
             break;
+        /* Int arithmetic wraps at 32 bits, slots are wider */
         case opcodes::IADD:
-            stack[stackTop - 2] =
-                    stack[stackTop - 2] + stack[stackTop - 1];
+            stack[stackTop - 2] = (int32_t)
+                    ((uint32_t) stack[stackTop - 2] + (uint32_t) stack[stackTop - 1]);
             stackTop--;
             pc++;
             break;
         case opcodes::ISUB:
-            stack[stackTop - 2] =
-                    stack[stackTop - 2] - stack[stackTop - 1];
+            stack[stackTop - 2] = (int32_t)
+                    ((uint32_t) stack[stackTop - 2] - (uint32_t) stack[stackTop - 1]);
             stackTop--;
             pc++;
             break;
         case opcodes::IMUL:
-            stack[stackTop - 2] =
-                    stack[stackTop - 2] * stack[stackTop - 1];
+            stack[stackTop - 2] = (int32_t)
+                    ((uint32_t) stack[stackTop - 2] * (uint32_t) stack[stackTop - 1]);
             stackTop--;
             pc++;
             break;
+        case opcodes::LADD:
+            *(int64_t *) &stack[stackTop - 4] = (int64_t)
+                    ((uint64_t) *(int64_t *) &stack[stackTop - 4] +
+                     (uint64_t) *(int64_t *) &stack[stackTop - 2]);
+            stackTop -= 2;
+            pc++;
+            break;
+        case opcodes::LSUB:
+            *(int64_t *) &stack[stackTop - 4] = (int64_t)
+                    ((uint64_t) *(int64_t *) &stack[stackTop - 4] -
+                     (uint64_t) *(int64_t *) &stack[stackTop - 2]);
+            stackTop -= 2;
+            pc++;
+            break;
         case opcodes::IINC:
             locals[code[pc + 1]] += code[pc + 2];
             pc += 3;
             break;
+        case opcodes::I2L:
+            *(int64_t *) &stack[stackTop - 1] = (int32_t) stack[stackTop - 1];
+            stackTop++;
+            pc++;
+            break;
+        case opcodes::L2I:
+            stack[stackTop - 2] = (int32_t) *(int64_t *) &stack[stackTop - 2];
+            stackTop--;
+            pc++;
+            break;
+        case opcodes::LCMP: {
+            int64_t a = *(int64_t *) &stack[stackTop - 4];
+            int64_t b = *(int64_t *) &stack[stackTop - 2];
+            stackTop -= 4;
+            stack[stackTop++] = a < b ? -1 : a > b ? 1 : 0;
+            pc++;
+            break;
+        }
         case opcodes::DUP:
             stack[stackTop] = stack[stackTop - 1];
             stackTop++;
@@ -489,41 +1221,70 @@ void Thread::runLoop()
             stackTop--;
             pc++;
             break;
+        case opcodes::POP2:
+            stackTop -= 2;
+            pc++;
+            break;
         case opcodes::IFNE:
-            if (stack[--stackTop] != 0)
-                pc += (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
-            else
+            if (stack[--stackTop] == 0)
                 pc += 3;
+            else if (jump())
+                return false;
             break;
         case opcodes::IFEQ:
-            if (stack[--stackTop] == 0)
-                pc += (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
-            else
+            if (stack[--stackTop] != 0)
                 pc += 3;
+            else if (jump())
+                return false;
             break;
-        case opcodes::IF_ICMPLT:
-            if (stack[stackTop - 2] < stack[stackTop - 1])
-                pc += (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
-            else
+        case opcodes::IFLT:
+            if (!(stack[--stackTop] < 0))
+                pc += 3;
+            else if (jump())
+                return false;
+            break;
+        case opcodes::IFGE:
+            if (!(stack[--stackTop] >= 0))
+                pc += 3;
+            else if (jump())
+                return false;
+            break;
+        case opcodes::IFGT:
+            if (!(stack[--stackTop] > 0))
                 pc += 3;
+            else if (jump())
+                return false;
+            break;
+        case opcodes::IFLE:
+            if (!(stack[--stackTop] <= 0))
+                pc += 3;
+            else if (jump())
+                return false;
+            break;
+        case opcodes::IF_ICMPLT:
             stackTop -= 2;
+            if (!(stack[stackTop] < stack[stackTop + 1]))
+                pc += 3;
+            else if (jump())
+                return false;
             break;
         case opcodes::IF_ICMPGE:
-            if (stack[stackTop - 2] >= stack[stackTop - 1])
-                pc += (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
-            else
-                pc += 3;
             stackTop -= 2;
+            if (!(stack[stackTop] >= stack[stackTop + 1]))
+                pc += 3;
+            else if (jump())
+                return false;
             break;
         case opcodes::IF_ICMPLE:
-            if (stack[stackTop - 2] <= stack[stackTop - 1])
-                pc += (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
-            else
-                pc += 3;
             stackTop -= 2;
+            if (!(stack[stackTop] <= stack[stackTop + 1]))
+                pc += 3;
+            else if (jump())
+                return false;
             break;
         case opcodes::GOTO:
-            pc += (int16_t) ((code[pc + 1] << 8) | code[pc + 2]);
+            if (jump())
+                return false;
             break;
         case opcodes::GETFIELD:
             tmpObject = (Object *) stack[--stackTop];
@@ -541,9 +1302,8 @@ void Thread::runLoop()
         case opcodes::GETSTATIC:
         case opcodes::PUTSTATIC:
             if (prepareStaticField()) {
-                saveFrame();
-                pushInit();
-                loadFrame();
+                if (!enterInit())
+                    return false;
                 break;
             }
             if (code[pc] == opcodes::GETSTATIC)
@@ -556,65 +1316,93 @@ void Thread::runLoop()
         case opcodes::INVOKESPECIAL:
             /* No valuable difference between them yet */
             if (prepareMethod()) {
-                saveFrame();
-                pushInit();
-                loadFrame();
+                if (!enterInit())
+                    return false;
                 break;
             }
             instanceMethod = code[pc] == opcodes::INVOKESPECIAL;
-            pc += 3;
-            saveFrame();
-            pushMethod(resolvedMethod);
-            loadFrame();
-            loadArgs();
+            if (!invokeResolved())
+                return false;
             break;
         case opcodes::INVOKEVIRTUAL:
-            prepareMethod();
+            if (prepareMethod()) {
+                if (!enterInit())
+                    return false;
+                break;
+            }
             tmpObject =
-                    (Object *) stack[stackTop - resolvedMethod->argDescriptors.size() - 1];
+                    (Object *) stack[stackTop - resolvedMethod->argSlots - 1];
             selectOverriding();
             instanceMethod = true;
-            pc += 3;
-            saveFrame();
-            pushMethod(resolvedMethod);
-            loadFrame();
-            loadArgs();
+            if (!invokeResolved())
+                return false;
             break;
         case opcodes::NEW:
             if (prepareClass(false)) {
-                saveFrame();
-                pushInit();
-                loadFrame();
+                if (!enterInit())
+                    return false;
                 break;
             }
-            tmpObject = memberClass->newObject();
-            stack[stackTop++] = (intptr_t) tmpObject;
+            newObject();
             pc += 3;
             break;
         case opcodes::NEWARRAY:
             newArray(code[pc + 1]);
             pc += 2;
             break;
+        case opcodes::MONITORENTER:
+            tmpObject = (Object *) stack[stackTop - 1];
+            saveFrame();
+            if (!enterMonitor(tmpObject->lockWord))
+                return false;
+            stackTop--;
+            pc++;
+            break;
+        case opcodes::MONITOREXIT:
+            tmpObject = (Object *) stack[--stackTop];
+            Monitor::exit(tmpObject->lockWord, this);
+            pc++;
+            break;
         case opcodes::IRETURN:
         case opcodes::ARETURN:
             ret = stack[--stackTop];
+            if (top == batchFrame)
+                return true;
             popFrame();
+            if (top == nullptr)
+                return true;
             loadFrame();
             stack[stackTop++] = ret;
             break;
+        case opcodes::LRETURN:
+            /* Slots and ret are 64 bits wide, as for native longs */
+            stackTop -= 2;
+            ret = *(int64_t *) &stack[stackTop];
+            if (top == batchFrame)
+                return true;
+            popFrame();
+            if (top == nullptr)
+                return true;
+            loadFrame();
+            *(int64_t *) &stack[stackTop] = ret;
+            stackTop += 2;
+            break;
         case opcodes::RETURN:
-            if (top->owner->isInit)
-                frameClass->initDone = true;
+            if (top == batchFrame)
+                return true;
+            isInit = top->owner->isInit;
+            if (isInit)
+                finishInit(frameClass);
             popFrame();
-            if (!initStack.empty())
+            if (isInit)
                 pushInit();
             if (top == nullptr)
-                return;
+                return true;
             loadFrame();
             break;
         default:
             std::cout << "Unimplemented instruction" << std::endl;
-            return;
+            return true;
         }
     }
 }
@@ -626,26 +1414,55 @@ bool Thread::prepareClass(bool ofMember=true)
         ref = static_cast<RefInfo *>(frameClass->classFile->constantPool[refIndex - 1]);
         refIndex = ref->firstIndex;
     }
-    std::string className = frameClass->classFile->getIndexName(refIndex);
+    memberClass = frameClass->resolveClass(refIndex);
+    memberClass->link();
+
+    /* Waits if another thread is initializing the class */
+    if (!isolate->state(memberClass)->initDone)
+        return prepareInit(memberClass) || blocked;
+    return false;
+}
 
-    memberClass = ClassCache::getClass(className);
+void Thread::loadConstant(uint16_t index)
+{
+    ClassFile *classFile = frameClass->classFile;
+    ConstantPoolInfo *constant = classFile->constantPool[index - 1];
 
-    if (!memberClass->initStarted && !memberClass->initDone) {
-        prepareInit(memberClass);
-        return !initStack.empty();
+    switch (constant->tag) {
+        case CONSTANT_Integer:
+        case CONSTANT_Float:
+            stack[stackTop++] = (int32_t) static_cast<Const32Info *>(constant)->value;
+            break;
+        case CONSTANT_Long:
+        case CONSTANT_Double:
+            *(int64_t *) &stack[stackTop] =
+                    (int64_t) static_cast<Const64Info *>(constant)->value;
+            stackTop += 2;
+            break;
+        case CONSTANT_String: {
+            uint16_t textIndex = static_cast<IndexInfo *>(constant)->index;
+            stack[stackTop++] = reinterpret_cast<intptr_t>(
+                    isolate->literal(classFile->getSymbol(textIndex)));
+            break;
+        }
+        default:
+            /* Class constants need java.lang.Class, not supported yet;
+             * a wrong value would go unnoticed, so the program stops */
+            std::cout.flush();
+            std::cerr << "Unsupported constant: tag " << (int) constant->tag
+                      << " at index " << index << " in "
+                      << frameClass->name << '.' << top->owner->name->str
+                      << top->owner->descriptor->str << std::endl;
+            std::exit(1);
     }
-    /* In other case we must wait for initialization
-     * only if initializing tread differs from current
-     */
-    return false;
 }
 
 void Thread::prepareMember()
 {
     uint16_t nameTypeIndex = ref->secondIndex;
     RefInfo *nameType = static_cast<RefInfo *>(frameClass->classFile->constantPool[nameTypeIndex - 1]);
-    memberName = frameClass->classFile->getUtf8(nameType->firstIndex);
-    descriptor = frameClass->classFile->getUtf8(nameType->secondIndex);
+    memberName = frameClass->classFile->getSymbol(nameType->firstIndex);
+    descriptor = frameClass->classFile->getSymbol(nameType->secondIndex);
 }
 
 bool Thread::prepareStaticField()
@@ -657,13 +1474,12 @@ bool Thread::prepareStaticField()
 
     isRef = isWide = false;
 
-    while (memberClass != nullptr) {
-        auto findIterator = memberClass->fieldOffset.find(memberName);
-        if (findIterator == memberClass->fieldOffset.end()) {
-            memberClass = memberClass->super;
-        } else {
-            offset = memberClass->fieldOffset[memberName];
-            fieldPtr = &memberClass->staticFields[offset];
+    for (; memberClass != nullptr; memberClass = memberClass->super) {
+        Field *field = memberClass->findField(memberName);
+        if (field != nullptr) {
+            offset = field->offset;
+            fieldType = field->type;
+            fieldPtr = &isolate->state(memberClass)->staticFields[offset];
             break;
         }
     }
@@ -676,12 +1492,11 @@ void Thread::prepareField()
     prepareClass();
     prepareMember();
 
-    while (memberClass != nullptr) {
-        auto findIterator = memberClass->fieldOffset.find(memberName);
-        if (findIterator == memberClass->fieldOffset.end()) {
-            memberClass = memberClass->super;
-        } else {
-            offset = memberClass->fieldOffset[memberName];
+    for (; memberClass != nullptr; memberClass = memberClass->super) {
+        Field *field = memberClass->findField(memberName);
+        if (field != nullptr) {
+            offset = field->offset;
+            fieldType = field->type;
             fieldPtr = &tmpObject->fields[offset];
             break;
         }
@@ -722,7 +1537,7 @@ void Thread::selectOverriding()
 
 void Thread::loadField()
 {
-    switch (descriptor[0]) {
+    switch (fieldType) {
         case 'B':
         case 'Z':
             stack[stackTop++] = *fieldPtr;
@@ -751,7 +1566,7 @@ void Thread::loadField()
 
 void Thread::storeField()
 {
-    switch (descriptor[0]) {
+    switch (fieldType) {
         case 'B':
         case 'Z':
             *fieldPtr = (int8_t) stack[--stackTop];
@@ -781,7 +1596,7 @@ void Thread::storeField()
 void Thread::loadArgs()
 {
     /* Now without special case for references */
-    uint16_t argsLength = top->owner->argDescriptors.size();
+    uint16_t argsLength = top->owner->argSlots;
     uint16_t argsStart = prev->stackTop - argsLength;
     int32_t local = 0, arg = 0;
     if (instanceMethod)
@@ -791,9 +1606,26 @@ void Thread::loadArgs()
         top->locals[local] = prev->stack[argsStart + arg];
 }
 
+void Thread::newObject()
+{
+    /* Profiler reads allocation site from the frame */
+    if (AllocationProfiler::enabled)
+        saveFrame();
+
+    /* Objects which don't escape the method live in its frame */
+    if (EscapeAnalysis::get(top->owner)->isLocalSite(pc))
+        tmpObject = Object::newLocalObject(memberClass, &arena);
+    else
+        tmpObject = memberClass->newObject();
+    stack[stackTop++] = (intptr_t) tmpObject;
+}
+
 void Thread::newArray(uint8_t type)
 {
-    std::string typeStr = primitiveArrays[code[pc + 1]];
+    if (AllocationProfiler::enabled)
+        saveFrame();
+
+    const std::string &typeStr = primitiveArrays[code[pc + 1]];
     Class *c = ClassCache::getClass(typeStr);
     ArrayClass *arrayClass = static_cast<ArrayClass *>(c);
     Object *array = arrayClass->newArray((int32_t) stack[--stackTop]);
@@ -837,6 +1669,8 @@ void Thread::storeBoolArray()
     stackTop -= 3;
 }
 
+bool Debug::trace = false;
+
 void Debug::debugCallStack(Frame *top)
 {
     int i = 0;
@@ -917,14 +1751,14 @@ void Debug::debugObject(Object *obj, int depth)
         std::cout << "...";
     } else {
         int i = 0;
-        for (std::string& fieldName : objClass->fieldNames) {
-            uint16_t fieldOffset = objClass->fieldOffset[fieldName];
-            std::string descriptor = objClass->descriptors[fieldName];
-            uint8_t *field = &obj->fields[fieldOffset];
+        for (Field &declared : objClass->fields) {
+            if (declared.isStatic)
+                continue;
+            uint8_t *field = &obj->fields[declared.offset];
             if (i > 0)
                 std::cout << ", ";
-            std::cout << fieldName << " = ";
-            switch (descriptor[0]) {
+            std::cout << declared.name->str << " = ";
+            switch (declared.type) {
                 case 'I':
                     std::cout << *reinterpret_cast<int32_t *>(field);
                     break;
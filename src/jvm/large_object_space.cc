@@ -0,0 +1,71 @@
+#include <config.h>
+
+#include <cstdlib>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <jvm/large_object_space.h>
+
+bool LargeObjectSpace::isLarge(uint32_t size)
+{
+    return size >= LARGE_OBJECT_THRESHOLD;
+}
+
+uint8_t *LargeObjectSpace::allocate(uint32_t size)
+{
+    return mapRegion(regionLength(size));
+}
+
+size_t LargeObjectSpace::regionLength(uint32_t size)
+{
+    size_t length = size;
+    size_t granularity = 4096;
+
+#ifdef HAVE_SYS_MMAN_H
+    granularity = sysconf(_SC_PAGESIZE);
+#endif
+    if (length >= HUGE_PAGE_SIZE)
+        granularity = HUGE_PAGE_SIZE;
+
+    return (length + granularity - 1) / granularity * granularity;
+}
+
+uint8_t *LargeObjectSpace::mapRegion(size_t length)
+{
+#ifdef HAVE_SYS_MMAN_H
+    /* Over-map to place huge regions on a huge page boundary */
+    size_t mapLength = length;
+    if (length >= HUGE_PAGE_SIZE)
+        mapLength += HUGE_PAGE_SIZE;
+
+    void *mapped = mmap(nullptr, mapLength, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        return nullptr;
+
+    uint8_t *start = static_cast<uint8_t *>(mapped);
+    uint8_t *base = start;
+    if (mapLength != length) {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(start) +
+                HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        base = reinterpret_cast<uint8_t *>(aligned);
+        if (base != start)
+            munmap(start, base - start);
+        size_t tail = (start + mapLength) - (base + length);
+        if (tail != 0)
+            munmap(base + length, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (length >= HUGE_PAGE_SIZE)
+        madvise(base, length, MADV_HUGEPAGE);
+#endif
+
+    return base;
+#else
+    return static_cast<uint8_t *>(calloc(length, 1));
+#endif
+}
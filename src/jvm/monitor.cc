@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <chrono>
+
+#include <jvm/jvm.h>
+#include <jvm/monitor.h>
+#include <jvm/safepoint.h>
+#include <jvm/scheduler.h>
+
+Monitor::Monitor(uint32_t owner, uint32_t recursion) :
+    owner(owner), recursion(recursion)
+{
+}
+
+Monitor *Monitor::inflated(uintptr_t value)
+{
+    if (!(value & inflatedBit))
+        return nullptr;
+    return reinterpret_cast<Monitor *>(value & ~inflatedBit);
+}
+
+Monitor *Monitor::inflate(LockWord &word)
+{
+    uintptr_t value = word.load(std::memory_order_acquire);
+
+    while (true) {
+        Monitor *monitor = inflated(value);
+        if (monitor != nullptr)
+            return monitor;
+
+        /* Thin owner may still run, it notices inflation on its next CAS */
+        uint32_t owner = value >> ownerShift;
+        uint32_t recursion = 0;
+        if (owner != 0)
+            recursion = ((value & recursionMask) / recursionUnit) + 1;
+
+        Monitor *created = new Monitor(owner, recursion);
+        uintptr_t inflatedValue = reinterpret_cast<uintptr_t>(created) | inflatedBit;
+        if (word.compare_exchange_weak(value, inflatedValue,
+                std::memory_order_acq_rel, std::memory_order_acquire))
+            return created;
+        delete created;
+    }
+}
+
+void Monitor::enter(LockWord &word, Thread *thread)
+{
+    uintptr_t id = thread->lockId;
+    uintptr_t thin = id << ownerShift;
+    uintptr_t value = 0;
+
+    /* Uncontended case is a single CAS */
+    if (word.compare_exchange_strong(value, thin,
+            std::memory_order_acquire, std::memory_order_relaxed))
+        return;
+
+    while (true) {
+        if (value == 0) {
+            if (word.compare_exchange_weak(value, thin,
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            continue;
+        }
+
+        Monitor *monitor = inflated(value);
+        if (monitor != nullptr) {
+            if (!monitor->tryLock(id)) {
+                SafeRegion region(thread);
+                monitor->lock(id);
+            }
+            return;
+        }
+
+        if ((value >> ownerShift) == id &&
+                (value & recursionMask) != recursionMask) {
+            if (word.compare_exchange_weak(value, value + recursionUnit,
+                    std::memory_order_relaxed, std::memory_order_relaxed))
+                return;
+            continue;
+        }
+
+        /* Held by another thread or recursion overflow */
+        monitor = inflate(word);
+        if (!monitor->tryLock(id)) {
+            SafeRegion region(thread);
+            monitor->lock(id);
+        }
+        return;
+    }
+}
+
+bool Monitor::tryEnter(LockWord &word, Thread *thread)
+{
+    uintptr_t id = thread->lockId;
+    uintptr_t value = word.load(std::memory_order_relaxed);
+
+    while (true) {
+        if (value == 0) {
+            if (word.compare_exchange_weak(value, id << ownerShift,
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+            continue;
+        }
+
+        Monitor *monitor = inflated(value);
+        if (monitor != nullptr)
+            return monitor->tryLock(id);
+
+        if ((value >> ownerShift) != id)
+            return false;
+
+        if ((value & recursionMask) == recursionMask)
+            return inflate(word)->tryLock(id);
+        if (word.compare_exchange_weak(value, value + recursionUnit,
+                std::memory_order_relaxed, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+bool Monitor::enterGreen(LockWord &word, Thread *thread)
+{
+    /* Parked threads are only ever listed on inflated locks, which are
+     * entered below so that the thread leaves the list */
+    if (inflated(word.load(std::memory_order_relaxed)) == nullptr &&
+            tryEnter(word, thread))
+        return true;
+
+    /* Only an inflated lock can tell the thread it is free */
+    Monitor *monitor = inflate(word);
+    std::lock_guard<std::mutex> guard(monitor->mutex);
+    uint32_t id = thread->lockId;
+    if (monitor->owner == id) {
+        monitor->recursion++;
+    } else if (monitor->owner == 0) {
+        monitor->owner = id;
+        monitor->recursion = 1;
+    } else {
+        addTask(monitor->entrants, thread);
+        return false;
+    }
+    removeTask(monitor->entrants, thread);
+    return true;
+}
+
+bool Monitor::exit(LockWord &word, Thread *thread)
+{
+    uintptr_t id = thread->lockId;
+    uintptr_t value = word.load(std::memory_order_relaxed);
+
+    while (true) {
+        Monitor *monitor = inflated(value);
+        if (monitor != nullptr)
+            return monitor->unlock(id);
+
+        if ((value >> ownerShift) != id)
+            return false;
+
+        uintptr_t next = (value & recursionMask) ? value - recursionUnit : 0;
+        if (word.compare_exchange_weak(value, next,
+                std::memory_order_release, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+bool Monitor::wait(LockWord &word, Thread *thread, int64_t millis)
+{
+    SafeRegion region(thread);
+    Monitor *monitor = inflate(word);
+    std::unique_lock<std::mutex> guard(monitor->mutex);
+
+    if (monitor->owner != thread->lockId)
+        return false;
+
+    uint32_t savedRecursion = monitor->recursion;
+    monitor->owner = 0;
+    monitor->recursion = 0;
+    monitor->released();
+
+    /* Spurious wakeups are allowed by the Java wait contract */
+    if (millis > 0)
+        monitor->notified.wait_for(guard, std::chrono::milliseconds(millis));
+    else
+        monitor->notified.wait(guard);
+
+    while (monitor->owner != 0)
+        monitor->entered.wait(guard);
+    monitor->owner = thread->lockId;
+    monitor->recursion = savedRecursion;
+
+    return true;
+}
+
+bool Monitor::waitGreen(LockWord &word, Thread *thread, int64_t millis)
+{
+    WaitState &state = thread->waitState;
+
+    if (state.monitor == nullptr) {
+        Monitor *monitor = inflate(word);
+        std::lock_guard<std::mutex> guard(monitor->mutex);
+        if (monitor->owner != thread->lockId)
+            return true;
+
+        state.monitor = monitor;
+        state.recursion = monitor->recursion;
+        state.notified = false;
+        state.timed = millis > 0;
+        state.deadline = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(millis);
+
+        monitor->owner = 0;
+        monitor->recursion = 0;
+        monitor->waiters++;
+        monitor->waitingTasks.push_back(thread);
+        if (state.timed)
+            Scheduler::wakeAt(thread, state.deadline);
+        monitor->released();
+        return false;
+    }
+
+    Monitor *monitor = state.monitor;
+    std::lock_guard<std::mutex> guard(monitor->mutex);
+
+    if (!state.notified) {
+        bool timedOut = state.timed &&
+                std::chrono::steady_clock::now() >= state.deadline;
+        if (monitor->permits == 0 && !timedOut) {
+            /* Another waiter took the notification this one was woken for */
+            addTask(monitor->waitingTasks, thread);
+            return false;
+        }
+
+        if (monitor->permits > 0)
+            monitor->permits--;
+        monitor->waiters--;
+        if (monitor->permits > monitor->waiters)
+            monitor->permits = monitor->waiters;
+        state.notified = true;
+        removeTask(monitor->waitingTasks, thread);
+        if (state.timed)
+            Scheduler::cancelWake(thread);
+    }
+
+    if (monitor->owner != 0) {
+        addTask(monitor->entrants, thread);
+        return false;
+    }
+    monitor->owner = thread->lockId;
+    monitor->recursion = state.recursion;
+    removeTask(monitor->entrants, thread);
+    state.monitor = nullptr;
+
+    return true;
+}
+
+bool Monitor::notify(LockWord &word, Thread *thread, bool all)
+{
+    Monitor *monitor = inflate(word);
+    std::lock_guard<std::mutex> guard(monitor->mutex);
+
+    if (monitor->owner != thread->lockId)
+        return false;
+
+    if (all) {
+        monitor->notified.notify_all();
+        monitor->permits = monitor->waiters;
+        while (!monitor->waitingTasks.empty())
+            wakeOne(monitor->waitingTasks);
+    } else {
+        monitor->notified.notify_one();
+        if (monitor->permits < monitor->waiters)
+            monitor->permits++;
+        wakeOne(monitor->waitingTasks);
+    }
+    return true;
+}
+
+void Monitor::lock(uint32_t id)
+{
+    std::unique_lock<std::mutex> guard(mutex);
+
+    if (owner == id) {
+        recursion++;
+        return;
+    }
+    while (owner != 0)
+        entered.wait(guard);
+    owner = id;
+    recursion = 1;
+}
+
+bool Monitor::tryLock(uint32_t id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+
+    if (owner == id) {
+        recursion++;
+        return true;
+    }
+    if (owner != 0)
+        return false;
+    owner = id;
+    recursion = 1;
+    return true;
+}
+
+bool Monitor::unlock(uint32_t id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+
+    if (owner != id)
+        return false;
+    if (--recursion == 0) {
+        owner = 0;
+        released();
+    }
+    return true;
+}
+
+void Monitor::released()
+{
+    entered.notify_one();
+    wakeOne(entrants);
+}
+
+void Monitor::wakeOne(std::deque<Thread *> &tasks)
+{
+    if (tasks.empty())
+        return;
+    Thread *task = tasks.front();
+    tasks.pop_front();
+    Scheduler::wake(task);
+}
+
+void Monitor::addTask(std::deque<Thread *> &tasks, Thread *thread)
+{
+    if (std::find(tasks.begin(), tasks.end(), thread) == tasks.end())
+        tasks.push_back(thread);
+}
+
+void Monitor::removeTask(std::deque<Thread *> &tasks, Thread *thread)
+{
+    auto found = std::find(tasks.begin(), tasks.end(), thread);
+    if (found != tasks.end())
+        tasks.erase(found);
+}
@@ -0,0 +1,530 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <jvm/jvm.h>
+#include <jvm/array_ops.h>
+#include <jvm/natives.h>
+#include <jvm/strings.h>
+#include <jvm/scheduler.h>
+#include <jvm/threads.h>
+
+static intptr_t threadStart(Thread *thread, intptr_t *args)
+{
+    ThreadManager::start(reinterpret_cast<Object *>(args[0]));
+    return 0;
+}
+
+static intptr_t threadJoin(Thread *thread, intptr_t *args)
+{
+    ThreadManager::join(thread, reinterpret_cast<Object *>(args[0]));
+    return 0;
+}
+
+static intptr_t objectWait(Thread *thread, intptr_t *args)
+{
+    Object *obj = reinterpret_cast<Object *>(args[0]);
+    if (Scheduler::active)
+        thread->blocked = !Monitor::waitGreen(obj->lockWord, thread);
+    else
+        Monitor::wait(obj->lockWord, thread);
+    return 0;
+}
+
+static intptr_t objectTimedWait(Thread *thread, intptr_t *args)
+{
+    Object *obj = reinterpret_cast<Object *>(args[0]);
+    int64_t millis = *reinterpret_cast<int64_t *>(&args[1]);
+    if (Scheduler::active)
+        thread->blocked = !Monitor::waitGreen(obj->lockWord, thread, millis);
+    else
+        Monitor::wait(obj->lockWord, thread, millis);
+    return 0;
+}
+
+static intptr_t objectNotify(Thread *thread, intptr_t *args)
+{
+    Object *obj = reinterpret_cast<Object *>(args[0]);
+    Monitor::notify(obj->lockWord, thread, false);
+    return 0;
+}
+
+static intptr_t objectNotifyAll(Thread *thread, intptr_t *args)
+{
+    Object *obj = reinterpret_cast<Object *>(args[0]);
+    Monitor::notify(obj->lockWord, thread, true);
+    return 0;
+}
+
+/* There are no exceptions to throw, the program is stopped instead */
+static void fatal(const char *exception)
+{
+    std::cout.flush();
+    std::cerr << "Exception " << exception << std::endl;
+    std::exit(1);
+}
+
+static intptr_t stringLength(Thread *thread, intptr_t *args)
+{
+    return Strings::length(reinterpret_cast<Object *>(args[0]));
+}
+
+static intptr_t stringCharAt(Thread *thread, intptr_t *args)
+{
+    Object *str = reinterpret_cast<Object *>(args[0]);
+    int32_t index = (int32_t) args[1];
+    if (str == nullptr)
+        fatal("java.lang.NullPointerException");
+    if (index < 0 || index >= Strings::length(str))
+        fatal("java.lang.StringIndexOutOfBoundsException");
+    return Strings::chars(str)[index];
+}
+
+/* Whole lines stay together when threads print concurrently */
+static std::mutex printLock;
+
+static void print(const std::string &text, bool newLine)
+{
+    std::lock_guard<std::mutex> guard(printLock);
+    std::cout << text;
+    if (newLine)
+        std::cout << '\n';
+}
+
+static intptr_t printString(Thread *thread, intptr_t *args)
+{
+    print(Strings::toUtf8(reinterpret_cast<Object *>(args[1])), false);
+    return 0;
+}
+
+static intptr_t printInt(Thread *thread, intptr_t *args)
+{
+    print(std::to_string((int32_t) args[1]), false);
+    return 0;
+}
+
+static intptr_t printLong(Thread *thread, intptr_t *args)
+{
+    print(std::to_string(*reinterpret_cast<int64_t *>(&args[1])), false);
+    return 0;
+}
+
+static std::string charText(intptr_t arg)
+{
+    std::string text;
+    Strings::appendUtf8(text, (uint16_t) arg);
+    return text;
+}
+
+static intptr_t printChar(Thread *thread, intptr_t *args)
+{
+    print(charText(args[1]), false);
+    return 0;
+}
+
+static intptr_t printBoolean(Thread *thread, intptr_t *args)
+{
+    print(args[1] ? "true" : "false", false);
+    return 0;
+}
+
+static intptr_t printlnString(Thread *thread, intptr_t *args)
+{
+    print(Strings::toUtf8(reinterpret_cast<Object *>(args[1])), true);
+    return 0;
+}
+
+static intptr_t printlnInt(Thread *thread, intptr_t *args)
+{
+    print(std::to_string((int32_t) args[1]), true);
+    return 0;
+}
+
+static intptr_t printlnLong(Thread *thread, intptr_t *args)
+{
+    print(std::to_string(*reinterpret_cast<int64_t *>(&args[1])), true);
+    return 0;
+}
+
+static intptr_t printlnChar(Thread *thread, intptr_t *args)
+{
+    print(charText(args[1]), true);
+    return 0;
+}
+
+static intptr_t printlnBoolean(Thread *thread, intptr_t *args)
+{
+    print(args[1] ? "true" : "false", true);
+    return 0;
+}
+
+static intptr_t println(Thread *thread, intptr_t *args)
+{
+    print("", true);
+    return 0;
+}
+
+static int64_t longArg(intptr_t *args, int index)
+{
+    return *reinterpret_cast<int64_t *>(&args[index]);
+}
+
+static intptr_t mathAbsInt(Thread *thread, intptr_t *args)
+{
+    int32_t value = (int32_t) args[0];
+    /* abs(MIN_VALUE) stays negative as in Java */
+    return (int32_t) (value < 0 ? 0u - (uint32_t) value : (uint32_t) value);
+}
+
+static intptr_t mathMaxInt(Thread *thread, intptr_t *args)
+{
+    return std::max((int32_t) args[0], (int32_t) args[1]);
+}
+
+static intptr_t mathMinInt(Thread *thread, intptr_t *args)
+{
+    return std::min((int32_t) args[0], (int32_t) args[1]);
+}
+
+static intptr_t mathAbsLong(Thread *thread, intptr_t *args)
+{
+    int64_t value = longArg(args, 0);
+    return (int64_t) (value < 0 ? 0u - (uint64_t) value : (uint64_t) value);
+}
+
+static intptr_t mathMaxLong(Thread *thread, intptr_t *args)
+{
+    return std::max(longArg(args, 0), longArg(args, 2));
+}
+
+static intptr_t mathMinLong(Thread *thread, intptr_t *args)
+{
+    return std::min(longArg(args, 0), longArg(args, 2));
+}
+
+static intptr_t currentTimeMillis(Thread *thread, intptr_t *args)
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(
+            system_clock::now().time_since_epoch()).count();
+}
+
+static intptr_t nanoTime(Thread *thread, intptr_t *args)
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+            steady_clock::now().time_since_epoch()).count();
+}
+
+/* Objects never move, the address mixed down to 31 bits is stable */
+static intptr_t identityHashCode(Thread *thread, intptr_t *args)
+{
+    uint64_t address = (uintptr_t) args[0];
+    if (address == 0)
+        return 0;
+    address = (address ^ (address >> 33)) * 0xff51afd7ed558ccdull;
+    return (int32_t) ((address ^ (address >> 33)) & 0x7fffffff);
+}
+
+static Object *nonNullArray(intptr_t arg)
+{
+    Object *array = reinterpret_cast<Object *>(arg);
+    if (array == nullptr)
+        fatal("java.lang.NullPointerException");
+    return array;
+}
+
+static intptr_t arraycopy(Thread *thread, intptr_t *args)
+{
+    Object *src = nonNullArray(args[0]), *dst = nonNullArray(args[2]);
+    int32_t srcPos = (int32_t) args[1], dstPos = (int32_t) args[3];
+    int32_t length = (int32_t) args[4];
+
+    /* Only arrays have no class file; reference stores are not checked */
+    ArrayClass *srcClass = static_cast<ArrayClass *>(src->cls);
+    ArrayClass *dstClass = static_cast<ArrayClass *>(dst->cls);
+    if (src->cls->classFile != nullptr || dst->cls->classFile != nullptr ||
+            srcClass->arrayOfPrimitives != dstClass->arrayOfPrimitives ||
+            (srcClass->arrayOfPrimitives && src->cls != dst->cls))
+        fatal("java.lang.ArrayStoreException");
+
+    if (srcPos < 0 || dstPos < 0 || length < 0 ||
+            srcPos > ArrayOps::length(src) - length ||
+            dstPos > ArrayOps::length(dst) - length)
+        fatal("java.lang.ArrayIndexOutOfBoundsException");
+
+    size_t itemSize = srcClass->itemSize();
+    ArrayOps::copy(ArrayOps::items<uint8_t>(dst) + dstPos * itemSize,
+            ArrayOps::items<uint8_t>(src) + srcPos * itemSize,
+            length * itemSize);
+    return 0;
+}
+
+/* Value is the second argument, long values fill both of its slots */
+template<typename T>
+static intptr_t arraysFill(Thread *thread, intptr_t *args)
+{
+    Object *array = nonNullArray(args[0]);
+    T value = sizeof(T) == LONG_SIZE ?
+            (T) longArg(args, 1) : (T) args[1];
+    ArrayOps::fill(ArrayOps::items<T>(array), &value, sizeof(T),
+            ArrayOps::length(array));
+    return 0;
+}
+
+template<typename T>
+static intptr_t arraysEquals(Thread *thread, intptr_t *args)
+{
+    Object *a = reinterpret_cast<Object *>(args[0]);
+    Object *b = reinterpret_cast<Object *>(args[1]);
+    if (a == b)
+        return 1;
+    if (a == nullptr || b == nullptr ||
+            ArrayOps::length(a) != ArrayOps::length(b))
+        return 0;
+    return ArrayOps::equals(ArrayOps::items<T>(a), ArrayOps::items<T>(b),
+            ArrayOps::length(a) * sizeof(T));
+}
+
+template<typename T>
+static intptr_t arraysHashCode(Thread *thread, intptr_t *args)
+{
+    Object *array = reinterpret_cast<Object *>(args[0]);
+    if (array == nullptr)
+        return 0;
+    return ArrayOps::hashCode(ArrayOps::items<T>(array),
+            ArrayOps::length(array));
+}
+
+static intptr_t arraysHashCodeLong(Thread *thread, intptr_t *args)
+{
+    Object *array = reinterpret_cast<Object *>(args[0]);
+    if (array == nullptr)
+        return 0;
+
+    uint32_t hash = 1;
+    uint64_t *items = ArrayOps::items<uint64_t>(array);
+    for (int32_t i = 0; i < ArrayOps::length(array); i++)
+        hash = 31 * hash + (uint32_t) (items[i] ^ (items[i] >> 32));
+    return (int32_t) hash;
+}
+
+static intptr_t arraysHashCodeBoolean(Thread *thread, intptr_t *args)
+{
+    Object *array = reinterpret_cast<Object *>(args[0]);
+    if (array == nullptr)
+        return 0;
+
+    uint32_t hash = 1;
+    int8_t *items = ArrayOps::items<int8_t>(array);
+    for (int32_t i = 0; i < ArrayOps::length(array); i++)
+        hash = 31 * hash + (items[i] ? 1231 : 1237);
+    return (int32_t) hash;
+}
+
+/* Unsigned char keeps char[] in Java order */
+template<typename T>
+static intptr_t arraysSort(Thread *thread, intptr_t *args)
+{
+    Object *array = nonNullArray(args[0]);
+    T *items = ArrayOps::items<T>(array);
+    std::sort(items, items + ArrayOps::length(array));
+    return 0;
+}
+
+/* Float.floatToIntBits and Double.doubleToLongBits, every NaN is
+ * the canonical one */
+static int32_t javaBits(float value)
+{
+    if (value != value)
+        return 0x7fc00000;
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static int64_t javaBits(double value)
+{
+    if (value != value)
+        return 0x7ff8000000000000ll;
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint32_t hashBits(float value)
+{
+    return (uint32_t) javaBits(value);
+}
+
+static uint32_t hashBits(double value)
+{
+    uint64_t bits = (uint64_t) javaBits(value);
+    return (uint32_t) (bits ^ (bits >> 32));
+}
+
+/* Float.compare: -0.0 before 0.0, NaN after everything */
+template<typename T>
+static bool javaLess(T a, T b)
+{
+    if (a < b)
+        return true;
+    if (a > b)
+        return false;
+    return javaBits(a) < javaBits(b);
+}
+
+/* Equal bits are the common case, only NaNs with other payloads
+ * need the second pass */
+template<typename T>
+static intptr_t arraysEqualsFloating(Thread *thread, intptr_t *args)
+{
+    Object *a = reinterpret_cast<Object *>(args[0]);
+    Object *b = reinterpret_cast<Object *>(args[1]);
+    if (a == b)
+        return 1;
+    if (a == nullptr || b == nullptr ||
+            ArrayOps::length(a) != ArrayOps::length(b))
+        return 0;
+
+    T *x = ArrayOps::items<T>(a), *y = ArrayOps::items<T>(b);
+    if (ArrayOps::equals(x, y, ArrayOps::length(a) * sizeof(T)))
+        return 1;
+    for (int32_t i = 0; i < ArrayOps::length(a); i++)
+        if (javaBits(x[i]) != javaBits(y[i]))
+            return 0;
+    return 1;
+}
+
+template<typename T>
+static intptr_t arraysHashCodeFloating(Thread *thread, intptr_t *args)
+{
+    Object *array = reinterpret_cast<Object *>(args[0]);
+    if (array == nullptr)
+        return 0;
+
+    uint32_t hash = 1;
+    T *items = ArrayOps::items<T>(array);
+    for (int32_t i = 0; i < ArrayOps::length(array); i++)
+        hash = 31 * hash + hashBits(items[i]);
+    return (int32_t) hash;
+}
+
+template<typename T>
+static intptr_t arraysSortFloating(Thread *thread, intptr_t *args)
+{
+    Object *array = nonNullArray(args[0]);
+    T *items = ArrayOps::items<T>(array);
+    std::sort(items, items + ArrayOps::length(array), javaLess<T>);
+    return 0;
+}
+
+struct NativeEntry
+{
+    const char *className, *name, *descriptor;
+    NativeMethod code;
+};
+
+static const NativeEntry nativeEntries[] = {
+    {"java/lang/Thread", "start", "()V", threadStart},
+    {"java/lang/Thread", "join",  "()V", threadJoin},
+    {"java/lang/Object", "wait",  "()V", objectWait},
+    {"java/lang/Object", "wait",  "(J)V", objectTimedWait},
+    {"java/lang/Object", "notify", "()V", objectNotify},
+    {"java/lang/Object", "notifyAll", "()V", objectNotifyAll},
+    {"java/lang/String", "length", "()I", stringLength},
+    {"java/lang/String", "charAt", "(I)C", stringCharAt},
+    {"java/io/PrintStream", "print", "(Ljava/lang/String;)V", printString},
+    {"java/io/PrintStream", "print", "(I)V", printInt},
+    {"java/io/PrintStream", "print", "(J)V", printLong},
+    {"java/io/PrintStream", "print", "(C)V", printChar},
+    {"java/io/PrintStream", "print", "(Z)V", printBoolean},
+    {"java/io/PrintStream", "println", "(Ljava/lang/String;)V", printlnString},
+    {"java/io/PrintStream", "println", "(I)V", printlnInt},
+    {"java/io/PrintStream", "println", "(J)V", printlnLong},
+    {"java/io/PrintStream", "println", "(C)V", printlnChar},
+    {"java/io/PrintStream", "println", "(Z)V", printlnBoolean},
+    {"java/io/PrintStream", "println", "()V", println},
+    {"java/lang/Math", "abs", "(I)I", mathAbsInt},
+    {"java/lang/Math", "max", "(II)I", mathMaxInt},
+    {"java/lang/Math", "min", "(II)I", mathMinInt},
+    {"java/lang/Math", "abs", "(J)J", mathAbsLong},
+    {"java/lang/Math", "max", "(JJ)J", mathMaxLong},
+    {"java/lang/Math", "min", "(JJ)J", mathMinLong},
+    {"java/lang/System", "currentTimeMillis", "()J", currentTimeMillis},
+    {"java/lang/System", "nanoTime", "()J", nanoTime},
+    {"java/lang/System", "identityHashCode", "(Ljava/lang/Object;)I",
+            identityHashCode},
+    {"java/lang/System", "arraycopy",
+            "(Ljava/lang/Object;ILjava/lang/Object;II)V", arraycopy},
+    {"java/util/Arrays", "fill", "([II)V", arraysFill<int32_t>},
+    {"java/util/Arrays", "fill", "([JJ)V", arraysFill<int64_t>},
+    {"java/util/Arrays", "fill", "([SS)V", arraysFill<int16_t>},
+    {"java/util/Arrays", "fill", "([CC)V", arraysFill<uint16_t>},
+    {"java/util/Arrays", "fill", "([BB)V", arraysFill<int8_t>},
+    {"java/util/Arrays", "fill", "([ZZ)V", arraysFill<int8_t>},
+    {"java/util/Arrays", "fill", "([FF)V", arraysFill<int32_t>},
+    {"java/util/Arrays", "fill", "([DD)V", arraysFill<int64_t>},
+    {"java/util/Arrays", "equals", "([I[I)Z", arraysEquals<int32_t>},
+    {"java/util/Arrays", "equals", "([J[J)Z", arraysEquals<int64_t>},
+    {"java/util/Arrays", "equals", "([S[S)Z", arraysEquals<int16_t>},
+    {"java/util/Arrays", "equals", "([C[C)Z", arraysEquals<uint16_t>},
+    {"java/util/Arrays", "equals", "([B[B)Z", arraysEquals<int8_t>},
+    {"java/util/Arrays", "equals", "([Z[Z)Z", arraysEquals<int8_t>},
+    {"java/util/Arrays", "equals", "([F[F)Z", arraysEqualsFloating<float>},
+    {"java/util/Arrays", "equals", "([D[D)Z", arraysEqualsFloating<double>},
+    {"java/util/Arrays", "hashCode", "([I)I", arraysHashCode<int32_t>},
+    {"java/util/Arrays", "hashCode", "([J)I", arraysHashCodeLong},
+    {"java/util/Arrays", "hashCode", "([S)I", arraysHashCode<int16_t>},
+    {"java/util/Arrays", "hashCode", "([C)I", arraysHashCode<uint16_t>},
+    {"java/util/Arrays", "hashCode", "([B)I", arraysHashCode<int8_t>},
+    {"java/util/Arrays", "hashCode", "([Z)I", arraysHashCodeBoolean},
+    {"java/util/Arrays", "hashCode", "([F)I", arraysHashCodeFloating<float>},
+    {"java/util/Arrays", "hashCode", "([D)I", arraysHashCodeFloating<double>},
+    {"java/util/Arrays", "sort", "([I)V", arraysSort<int32_t>},
+    {"java/util/Arrays", "sort", "([J)V", arraysSort<int64_t>},
+    {"java/util/Arrays", "sort", "([S)V", arraysSort<int16_t>},
+    {"java/util/Arrays", "sort", "([C)V", arraysSort<uint16_t>},
+    {"java/util/Arrays", "sort", "([B)V", arraysSort<int8_t>},
+    {"java/util/Arrays", "sort", "([F)V", arraysSortFloating<float>},
+    {"java/util/Arrays", "sort", "([D)V", arraysSortFloating<double>},
+};
+
+std::mutex Natives::lock;
+std::unordered_map<std::string, NativeMethod> Natives::registry;
+
+std::string Natives::key(const std::string &className,
+        const std::string &name, const std::string &descriptor)
+{
+    return className + '.' + name + ':' + descriptor;
+}
+
+void Natives::addBuiltins()
+{
+    for (const NativeEntry &entry : nativeEntries)
+        registry.emplace(key(entry.className, entry.name, entry.descriptor),
+                entry.code);
+}
+
+NativeMethod Natives::find(const std::string &className,
+        const std::string &name, const std::string &descriptor)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (registry.empty())
+        addBuiltins();
+
+    auto found = registry.find(key(className, name, descriptor));
+    return found != registry.end() ? found->second : nullptr;
+}
+
+void Natives::add(const std::string &className, const std::string &name,
+        const std::string &descriptor, NativeMethod code)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (registry.empty())
+        addBuiltins();
+
+    registry[key(className, name, descriptor)] = code;
+}
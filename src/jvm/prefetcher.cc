@@ -0,0 +1,109 @@
+#include <cstdlib>
+
+#include <jvm/jvm.h>
+#include <jvm/prefetcher.h>
+
+std::atomic<bool> Prefetcher::enabled{false};
+std::mutex Prefetcher::lock;
+std::condition_variable Prefetcher::workCond;
+std::deque<std::string> Prefetcher::pending;
+std::unordered_set<std::string> Prefetcher::seen;
+std::vector<std::thread> Prefetcher::workers;
+bool Prefetcher::stopping = false;
+bool Prefetcher::exitHookAdded = false;
+
+void Prefetcher::start(unsigned threadCount)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!exitHookAdded) {
+        std::atexit(abandon);
+        exitHookAdded = true;
+    }
+    stopping = false;
+    for (unsigned i = 0; i < threadCount; i++)
+        workers.push_back(std::thread(work));
+    enabled = true;
+}
+
+void Prefetcher::requestStop()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        enabled = false;
+        stopping = true;
+        pending.clear();
+        seen.clear();
+    }
+    workCond.notify_all();
+}
+
+void Prefetcher::stop()
+{
+    requestStop();
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+/* Exit can come from any thread, a worker included, and a worker may
+ * wait for a class the exiting thread was loading; joining could hang,
+ * so the workers end with the process */
+void Prefetcher::abandon()
+{
+    requestStop();
+    for (std::thread &worker : workers)
+        worker.detach();
+    workers.clear();
+}
+
+void Prefetcher::classLoaded(Class *cls)
+{
+    ClassFile *classFile = cls->classFile;
+    if (classFile == nullptr)
+        return;
+
+    std::vector<std::string> names;
+    for (ConstantPoolInfo *constant : classFile->constantPool) {
+        if (constant == nullptr || constant->tag != CONSTANT_Class)
+            continue;
+
+        std::string name = classFile->getUtf8(static_cast<IndexInfo *>(constant)->index);
+        /* Arrays are made on demand, their element classes are loaded */
+        size_t dimensions = name.find_first_not_of('[');
+        if (dimensions != 0) {
+            if (dimensions == std::string::npos || name[dimensions] != 'L')
+                continue;
+            name = name.substr(dimensions + 1, name.length() - dimensions - 2);
+        }
+        names.push_back(name);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (stopping)
+            return;
+        for (std::string &name : names)
+            if (seen.insert(name).second)
+                pending.push_back(name);
+    }
+    workCond.notify_all();
+}
+
+void Prefetcher::work()
+{
+    while (true) {
+        std::string name;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            workCond.wait(guard, [] { return stopping || !pending.empty(); });
+            if (stopping)
+                return;
+            name = pending.front();
+            pending.pop_front();
+        }
+
+        /* Missing classes are left for the interpreter to fail on */
+        if (ClassCache::findLoaded(name) == nullptr && ClassLoader::canLoad(name))
+            ClassCache::getClass(name);
+    }
+}
@@ -0,0 +1,127 @@
+#include <jvm/jvm.h>
+#include <jvm/safepoint.h>
+
+std::atomic<bool> Safepoint::requested{false};
+std::mutex Safepoint::lock;
+std::condition_variable Safepoint::stoppedCond, Safepoint::resumedCond;
+int Safepoint::running = 0;
+bool Safepoint::active = false;
+Safepoint::Clock::time_point Safepoint::beginTime;
+uint64_t Safepoint::count = 0, Safepoint::ttspTotal = 0, Safepoint::ttspMax = 0,
+        Safepoint::pauseTotal = 0, Safepoint::pauseMax = 0;
+std::thread Safepoint::periodicThread;
+std::mutex Safepoint::periodicLock;
+std::condition_variable Safepoint::periodicCond;
+bool Safepoint::periodicStop = false;
+
+static uint64_t microsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+void Safepoint::begin()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    /* One safepoint at a time */
+    while (active)
+        resumedCond.wait(guard);
+    active = true;
+    beginTime = Clock::now();
+    requested.store(true, std::memory_order_seq_cst);
+
+    while (running > 0)
+        stoppedCond.wait(guard);
+
+    uint64_t ttsp = microsSince(beginTime);
+    count++;
+    ttspTotal += ttsp;
+    if (ttsp > ttspMax)
+        ttspMax = ttsp;
+}
+
+void Safepoint::end()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    uint64_t pause = microsSince(beginTime);
+    pauseTotal += pause;
+    if (pause > pauseMax)
+        pauseMax = pause;
+
+    active = false;
+    requested.store(false, std::memory_order_release);
+    resumedCond.notify_all();
+}
+
+void Safepoint::block(Thread *thread)
+{
+    enterSafeRegion(thread);
+    leaveSafeRegion(thread);
+}
+
+void Safepoint::enterSafeRegion(Thread *thread)
+{
+    if (thread->safeDepth++ != 0)
+        return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (--running == 0 && active)
+        stoppedCond.notify_all();
+}
+
+void Safepoint::leaveSafeRegion(Thread *thread)
+{
+    if (--thread->safeDepth != 0)
+        return;
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (active)
+        resumedCond.wait(guard);
+    running++;
+}
+
+void Safepoint::startPeriodic(uint32_t intervalMillis)
+{
+    periodicStop = false;
+    periodicThread = std::thread(periodic, intervalMillis);
+}
+
+void Safepoint::stopPeriodic()
+{
+    if (!periodicThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> guard(periodicLock);
+        periodicStop = true;
+    }
+    periodicCond.notify_all();
+    periodicThread.join();
+}
+
+void Safepoint::periodic(uint32_t intervalMillis)
+{
+    std::unique_lock<std::mutex> guard(periodicLock);
+
+    while (!periodicCond.wait_for(guard,
+            std::chrono::milliseconds(intervalMillis),
+            [] { return periodicStop; })) {
+        begin();
+        end();
+    }
+}
+
+void Safepoint::report(std::ostream &out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    out << "Safepoints: " << count << std::endl;
+    if (count == 0)
+        return;
+    out << "  time to safepoint: avg " << ttspTotal / count
+        << " us, max " << ttspMax << " us" << std::endl
+        << "  pause:             avg " << pauseTotal / count
+        << " us, max " << pauseMax << " us, total " << pauseTotal
+        << " us" << std::endl;
+}
@@ -0,0 +1,218 @@
+#include <limits>
+
+#include <jvm/jvm.h>
+#include <jvm/scheduler.h>
+#include <jvm/threads.h>
+
+bool Scheduler::active = false;
+std::vector<Scheduler::RunQueue *> Scheduler::queues;
+std::atomic<size_t> Scheduler::liveTasks{0}, Scheduler::queuedTasks{0},
+        Scheduler::nextQueue{0};
+std::mutex Scheduler::idleLock;
+std::condition_variable Scheduler::idleCond;
+thread_local int Scheduler::workerIndex = -1;
+
+std::mutex Scheduler::timerLock;
+std::multimap<Scheduler::Clock::time_point, Thread *> Scheduler::timers;
+const Scheduler::Clock::rep Scheduler::noTimer =
+        std::numeric_limits<Clock::rep>::max();
+std::atomic<Scheduler::Clock::rep> Scheduler::nextTimer{noTimer};
+
+void Scheduler::run(const std::vector<Thread *> &mainTasks, unsigned workerCount)
+{
+    if (workerCount == 0)
+        workerCount = 1;
+
+    active = true;
+    for (unsigned i = 0; i < workerCount; i++)
+        queues.push_back(new RunQueue);
+
+    /* Submitted first so that workers never see an empty VM */
+    for (Thread *mainTask : mainTasks)
+        submit(mainTask);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(work, i));
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void Scheduler::submit(Thread *task)
+{
+    liveTasks++;
+    enqueue(task);
+}
+
+void Scheduler::enqueue(Thread *task)
+{
+    size_t index = workerIndex >= 0 ?
+            workerIndex : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(task);
+    }
+    queuedTasks++;
+    notifyIdle(false);
+}
+
+/* Workers check for work under idleLock, so notifying under it too
+ * means no worker goes to sleep past new work */
+void Scheduler::notifyIdle(bool all)
+{
+    std::lock_guard<std::mutex> guard(idleLock);
+    if (all)
+        idleCond.notify_all();
+    else
+        idleCond.notify_one();
+}
+
+Thread *Scheduler::take(int index)
+{
+    size_t count = queues.size();
+
+    for (size_t i = 0; i < count; i++) {
+        RunQueue *queue = queues[(index + i) % count];
+        std::lock_guard<std::mutex> guard(queue->lock);
+        if (queue->tasks.empty())
+            continue;
+
+        Thread *task;
+        if (i == 0) {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+        } else {
+            /* Thieves take from the other end */
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+        queuedTasks--;
+        return task;
+    }
+
+    return nullptr;
+}
+
+void Scheduler::work(int index)
+{
+    workerIndex = index;
+
+    while (true) {
+        fireTimers();
+
+        Thread *task = take(index);
+        if (task == nullptr) {
+            std::unique_lock<std::mutex> guard(idleLock);
+            if (liveTasks == 0)
+                return;
+            if (queuedTasks > 0)
+                continue;
+
+            Clock::rep next = nextTimer.load();
+            if (next == noTimer)
+                idleCond.wait(guard);
+            else
+                idleCond.wait_until(guard,
+                        Clock::time_point(Clock::duration(next)));
+            continue;
+        }
+
+        /* Wakeups meant for an earlier run are stale now */
+        task->parkState.store(RUNNING);
+        if (task->runLoop()) {
+            finish(task);
+            continue;
+        }
+
+        if (task->blocked)
+            park(task);
+        else
+            enqueue(task);
+    }
+}
+
+void Scheduler::park(Thread *task)
+{
+    uint8_t state = RUNNING;
+    if (task->parkState.compare_exchange_strong(state, PARKED))
+        return;
+
+    /* Woken before it got parked, the wait is retried right away */
+    task->parkState.store(RUNNING);
+    enqueue(task);
+}
+
+void Scheduler::wake(Thread *task)
+{
+    uint8_t state = task->parkState.load();
+
+    while (true) {
+        if (state == PARKED) {
+            if (task->parkState.compare_exchange_weak(state, RUNNING)) {
+                enqueue(task);
+                return;
+            }
+        } else if (state == RUNNING) {
+            if (task->parkState.compare_exchange_weak(state, WAKE_PENDING))
+                return;
+        } else {
+            return;
+        }
+    }
+}
+
+void Scheduler::wakeAt(Thread *task, Clock::time_point deadline)
+{
+    {
+        std::lock_guard<std::mutex> guard(timerLock);
+        timers.emplace(deadline, task);
+        updateNextTimer();
+    }
+    /* Sleeping workers wait for the new deadline instead */
+    notifyIdle(true);
+}
+
+void Scheduler::cancelWake(Thread *task)
+{
+    std::lock_guard<std::mutex> guard(timerLock);
+    for (auto it = timers.begin(); it != timers.end(); ++it) {
+        if (it->second == task) {
+            timers.erase(it);
+            break;
+        }
+    }
+    updateNextTimer();
+}
+
+void Scheduler::updateNextTimer()
+{
+    nextTimer.store(timers.empty() ? noTimer :
+            timers.begin()->first.time_since_epoch().count());
+}
+
+void Scheduler::fireTimers()
+{
+    if (nextTimer.load(std::memory_order_relaxed) >
+            Clock::now().time_since_epoch().count())
+        return;
+
+    /* Woken under timerLock, a cancelling task waits until it is done */
+    std::lock_guard<std::mutex> guard(timerLock);
+    Clock::time_point now = Clock::now();
+    while (!timers.empty() && timers.begin()->first <= now) {
+        Thread *task = timers.begin()->second;
+        timers.erase(timers.begin());
+        wake(task);
+    }
+    updateNextTimer();
+}
+
+void Scheduler::finish(Thread *task)
+{
+    if (task->threadObject != nullptr)
+        ThreadManager::finished(task->threadObject);
+    delete task;
+
+    if (--liveTasks == 0)
+        notifyIdle(true);
+}
@@ -0,0 +1,602 @@
+#include <config.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <class/java_class.h>
+#include <class/symbol.h>
+#include <io/memory_byte_reader.h>
+#include <jvm/class_path.h>
+#include <jvm/shared_archive.h>
+
+static const char ARCHIVE_MAGIC[4] = {'J', 'S', 'A', '1'};
+/* Bumped whenever the layout changes, also rejects other byte orders */
+static const uint32_t ARCHIVE_VERSION = 0x00020001;
+
+/* Without a class path classes are read from the current directory */
+static std::string sourcePath(const std::string &className)
+{
+    return ClassPath::empty() ? className + ".class" : ClassPath::source(className);
+}
+
+bool SharedArchive::recording = false;
+const uint8_t *SharedArchive::base = nullptr;
+size_t SharedArchive::mappedLength = 0;
+const SharedArchive::Entry *SharedArchive::entries = nullptr;
+uint32_t SharedArchive::count = 0;
+const SharedArchive::StringEntry *SharedArchive::strings = nullptr;
+uint32_t SharedArchive::stringCount = 0;
+std::vector<Symbol *> SharedArchive::symbols;
+std::mutex SharedArchive::lock;
+std::map<std::string, SharedArchive::Source> SharedArchive::recorded;
+
+bool SharedArchive::open(const std::string &path)
+{
+#ifdef HAVE_SYS_STAT_H
+    const uint8_t *data = nullptr;
+    size_t length = 0;
+
+#ifdef HAVE_SYS_MMAN_H
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(Header)) {
+        length = st.st_size;
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED)
+            data = static_cast<const uint8_t *>(mapped);
+    }
+    close(fd);
+#else
+    std::ifstream f(path.c_str(), std::ifstream::binary);
+    std::vector<char> contents((std::istreambuf_iterator<char>(f)),
+            std::istreambuf_iterator<char>());
+    if (contents.size() >= sizeof(Header)) {
+        length = contents.size();
+        uint8_t *copy = new uint8_t[length];
+        memcpy(copy, contents.data(), length);
+        data = copy;
+    }
+#endif
+    if (data == nullptr)
+        return false;
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    size_t tableEnd = sizeof(Header) + (size_t) header->count * sizeof(Entry) +
+            (size_t) header->stringCount * sizeof(StringEntry);
+    if (memcmp(header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ||
+            header->version != ARCHIVE_VERSION || tableEnd > length) {
+#ifdef HAVE_SYS_MMAN_H
+        munmap(const_cast<uint8_t *>(data), length);
+#else
+        delete[] data;
+#endif
+        return false;
+    }
+
+    /* Reject entries pointing outside, lookups then trust the tables */
+    const Entry *table = reinterpret_cast<const Entry *>(data + sizeof(Header));
+    const StringEntry *stringTable =
+            reinterpret_cast<const StringEntry *>(table + header->count);
+    bool inside = true;
+    for (uint32_t i = 0; i < header->count; i++) {
+        const Entry &entry = table[i];
+        inside &= (uint64_t) entry.nameOffset + entry.nameLength <= length &&
+                (uint64_t) entry.dataOffset + entry.dataLength <= length &&
+                entry.dataOffset % sizeof(uint64_t) == 0 &&
+                entry.sourceIndex < header->stringCount;
+    }
+    for (uint32_t i = 0; i < header->stringCount; i++)
+        inside &= (uint64_t) stringTable[i].offset + stringTable[i].length <= length;
+    if (!inside) {
+#ifdef HAVE_SYS_MMAN_H
+        munmap(const_cast<uint8_t *>(data), length);
+#else
+        delete[] data;
+#endif
+        return false;
+    }
+
+    base = data;
+    mappedLength = length;
+    entries = table;
+    count = header->count;
+    strings = stringTable;
+    stringCount = header->stringCount;
+    symbols.assign(stringCount, nullptr);
+    return true;
+#else
+    return false;
+#endif
+}
+
+const SharedArchive::Entry *SharedArchive::lookup(const std::string &className)
+{
+    uint32_t low = 0, high = count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        int order = compare(entries[middle], className);
+        if (order == 0) {
+            const Entry &entry = entries[middle];
+            const StringEntry &recordedSource = strings[entry.sourceIndex];
+            std::string source = sourcePath(className);
+            uint64_t size;
+            int64_t time;
+            if (source.length() != recordedSource.length ||
+                    memcmp(source.data(), base + recordedSource.offset,
+                        source.length()) != 0 ||
+                    !sourceInfo(source, size, time) ||
+                    size != entry.sourceSize || time != entry.sourceTime)
+                return nullptr;
+            return &entry;
+        }
+
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return nullptr;
+}
+
+bool SharedArchive::contains(const std::string &className)
+{
+    return lookup(className) != nullptr;
+}
+
+/* Every array of the record lies inside its entry and every string
+ * index inside the string table */
+bool SharedArchive::valid(const Entry &entry)
+{
+    const uint8_t *data = base + entry.dataOffset;
+    auto inside = [&](uint64_t offset, uint64_t length) {
+        return offset + length <= entry.dataLength;
+    };
+
+    if (!inside(0, sizeof(ClassRecord)))
+        return false;
+    const ClassRecord *record = reinterpret_cast<const ClassRecord *>(data);
+    size_t members = (size_t) record->fieldsCount + record->methodsCount;
+    if (record->constantPoolCount == 0 ||
+            !inside(record->poolOffset, (uint64_t) (record->constantPoolCount - 1) *
+                sizeof(PoolRecord)) ||
+            !inside(record->interfacesOffset,
+                (uint64_t) record->interfacesCount * sizeof(uint16_t)) ||
+            !inside(record->membersOffset, members * sizeof(MemberRecord)))
+        return false;
+
+    const PoolRecord *pool =
+            reinterpret_cast<const PoolRecord *>(data + record->poolOffset);
+    for (uint16_t i = 0; i + 1 < record->constantPoolCount; i++)
+        if (pool[i].tag == CONSTANT_Utf8 && pool[i].value >= stringCount)
+            return false;
+
+    const MemberRecord *member =
+            reinterpret_cast<const MemberRecord *>(data + record->membersOffset);
+    for (size_t i = 0; i < members; i++, member++) {
+        if (!inside(member->codeOffset, member->codeLength) ||
+                !inside(member->linesOffset,
+                    (uint64_t) member->linesCount * sizeof(LineNumber)) ||
+                !inside(member->variablesOffset,
+                    (uint64_t) member->variablesCount * sizeof(Variable)))
+            return false;
+    }
+    return true;
+}
+
+Symbol *SharedArchive::symbol(uint32_t index)
+{
+    if (symbols[index] == nullptr) {
+        const StringEntry &entry = strings[index];
+        symbols[index] = Symbol::intern(std::string(
+                reinterpret_cast<const char *>(base + entry.offset), entry.length));
+    }
+    return symbols[index];
+}
+
+static ConstantPoolInfo *poolEntry(uint8_t tag, uint16_t first,
+        uint16_t second, uint64_t value, Symbol *name)
+{
+    switch (tag) {
+        case CONSTANT_Utf8: {
+            Utf8Info *utf8 = new Utf8Info;
+            utf8->str = name->str;
+            utf8->symbol = name;
+            return utf8;
+        }
+        case CONSTANT_Integer:
+        case CONSTANT_Float: {
+            Const32Info *constant = new Const32Info;
+            constant->value = (uint32_t) value;
+            return constant;
+        }
+        case CONSTANT_Long:
+        case CONSTANT_Double: {
+            Const64Info *constant = new Const64Info;
+            constant->value = value;
+            return constant;
+        }
+        case CONSTANT_String:
+        case CONSTANT_Class: {
+            IndexInfo *index = new IndexInfo;
+            index->index = first;
+            return index;
+        }
+        case 0:
+            return new UnusableInfo;
+        default: {
+            RefInfo *ref = new RefInfo;
+            ref->firstIndex = first;
+            ref->secondIndex = second;
+            return ref;
+        }
+    }
+}
+
+ClassFile *SharedArchive::load(const std::string &className)
+{
+    const Entry *entry = lookup(className);
+    if (entry == nullptr || !valid(*entry))
+        return nullptr;
+
+    const uint8_t *data = base + entry->dataOffset;
+    const ClassRecord *record = reinterpret_cast<const ClassRecord *>(data);
+    ClassFile *cf = new ClassFile;
+    cf->magic = 0xCAFEBABE;
+    cf->minorVersion = record->minorVersion;
+    cf->majorVersion = record->majorVersion;
+    cf->accessFlags = record->accessFlags;
+    cf->thisClass = record->thisClass;
+    cf->superClass = record->superClass;
+    cf->attributesCount = 0;
+
+    cf->constantPoolCount = record->constantPoolCount;
+    const PoolRecord *pool =
+            reinterpret_cast<const PoolRecord *>(data + record->poolOffset);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (uint16_t i = 0; i + 1 < record->constantPoolCount; i++) {
+            const PoolRecord &item = pool[i];
+            ConstantPoolInfo *constant = poolEntry(item.tag, item.first,
+                    item.second, item.value, item.tag == CONSTANT_Utf8 ?
+                    symbol(item.value) : nullptr);
+            constant->tag = item.tag;
+            cf->constantPool.push_back(constant);
+        }
+    }
+
+    const uint16_t *interfaces =
+            reinterpret_cast<const uint16_t *>(data + record->interfacesOffset);
+    cf->interfacesCount = record->interfacesCount;
+    cf->interfaces.assign(interfaces, interfaces + record->interfacesCount);
+
+    const MemberRecord *member =
+            reinterpret_cast<const MemberRecord *>(data + record->membersOffset);
+    cf->fieldsCount = record->fieldsCount;
+    cf->methodsCount = record->methodsCount;
+    for (size_t i = 0; i < (size_t) record->fieldsCount + record->methodsCount;
+            i++, member++) {
+        MemberInfo *info = new MemberInfo;
+        info->accessFlags = member->accessFlags;
+        info->nameIndex = member->nameIndex;
+        info->descriptorIndex = member->descriptorIndex;
+        if (member->codeName != 0) {
+            CodeAttribute *code = new CodeAttribute;
+            code->nameIndex = member->codeName;
+            code->maxStack = member->maxStack;
+            code->maxLocals = member->maxLocals;
+            code->codeLength = member->codeLength;
+            /* Nothing writes to code, it is read from the mapping */
+            code->code = const_cast<uint8_t *>(data + member->codeOffset);
+            code->exceptionTableLength = 0;
+
+            if (member->linesName != 0) {
+                const LineNumber *lines = reinterpret_cast<const LineNumber *>(
+                        data + member->linesOffset);
+                LineNumberTableAttribute *table = new LineNumberTableAttribute;
+                table->nameIndex = member->linesName;
+                table->lineNumberTableLength = member->linesCount;
+                table->lineNumberTable.assign(lines, lines + member->linesCount);
+                table->length = 2 + member->linesCount * 4;
+                code->attributes.push_back(table);
+            }
+            if (member->variablesName != 0) {
+                const Variable *variables = reinterpret_cast<const Variable *>(
+                        data + member->variablesOffset);
+                LocalVariableTableAttribute *table = new LocalVariableTableAttribute;
+                table->nameIndex = member->variablesName;
+                table->numberOfEntries = member->variablesCount;
+                table->entries.assign(variables, variables + member->variablesCount);
+                table->length = 2 + member->variablesCount * 10;
+                code->attributes.push_back(table);
+            }
+
+            code->attributesCount = code->attributes.size();
+            code->length = 12 + code->codeLength;
+            for (AttributeInfo *attr : code->attributes)
+                code->length += 6 + attr->length;
+            info->attributes.push_back(code);
+        }
+        info->attributesCount = info->attributes.size();
+
+        if (i < record->fieldsCount)
+            cf->fields.push_back(info);
+        else
+            cf->methods.push_back(info);
+    }
+
+    return cf;
+}
+
+const std::vector<uint8_t> &SharedArchive::record(const std::string &className)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Source &source = recorded[className];
+    if (source.bytes.empty()) {
+        source.path = sourcePath(className);
+        if (ClassPath::empty()) {
+            std::ifstream f(source.path.c_str(), std::ifstream::binary);
+            source.bytes.assign(std::istreambuf_iterator<char>(f),
+                    std::istreambuf_iterator<char>());
+        } else {
+            size_t length;
+            std::vector<uint8_t> buffer;
+            const uint8_t *data = ClassPath::find(className, length, buffer);
+            if (data != nullptr)
+                source.bytes.assign(data, data + length);
+        }
+        sourceInfo(source.path, source.size, source.time);
+    }
+
+    return source.bytes;
+}
+
+/* Appends items at the next 8-byte boundary, returns their offset */
+template<typename T>
+static uint32_t append(std::vector<uint8_t> &data, const T *items, size_t count)
+{
+    data.resize((data.size() + 7) & ~(size_t) 7);
+    uint32_t offset = data.size();
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(items);
+    data.insert(data.end(), bytes, bytes + count * sizeof(T));
+    return offset;
+}
+
+bool SharedArchive::flatten(ClassFile &cf, std::vector<uint8_t> &data,
+        std::map<std::string, uint32_t> &stringIndex,
+        std::vector<std::string> &stringList)
+{
+    std::vector<PoolRecord> pool(cf.constantPool.size());
+    for (size_t i = 0; i < pool.size(); i++) {
+        ConstantPoolInfo *constant = cf.constantPool[i];
+        PoolRecord &item = pool[i];
+        memset(&item, 0, sizeof(item));
+        item.tag = constant->tag;
+        switch (constant->tag) {
+            case CONSTANT_Utf8: {
+                const std::string &str = static_cast<Utf8Info *>(constant)->str;
+                auto added = stringIndex.emplace(str, stringList.size());
+                if (added.second)
+                    stringList.push_back(str);
+                item.value = added.first->second;
+                break;
+            }
+            case CONSTANT_Integer:
+            case CONSTANT_Float:
+                item.value = static_cast<Const32Info *>(constant)->value;
+                break;
+            case CONSTANT_Long:
+            case CONSTANT_Double:
+                item.value = static_cast<Const64Info *>(constant)->value;
+                break;
+            case CONSTANT_String:
+            case CONSTANT_Class:
+                item.first = static_cast<IndexInfo *>(constant)->index;
+                break;
+            case CONSTANT_Methodref:
+            case CONSTANT_Fieldref:
+            case CONSTANT_InterfaceMethodref:
+            case CONSTANT_NameAndType:
+                item.first = static_cast<RefInfo *>(constant)->firstIndex;
+                item.second = static_cast<RefInfo *>(constant)->secondIndex;
+                break;
+            case 0:
+                break;
+            default:
+                return false;
+        }
+    }
+
+    std::vector<MemberInfo *> members(cf.fields);
+    members.insert(members.end(), cf.methods.begin(), cf.methods.end());
+    std::vector<MemberRecord> memberRecords(members.size());
+    std::vector<uint8_t> tail;
+    for (size_t i = 0; i < members.size(); i++) {
+        MemberRecord &member = memberRecords[i];
+        memset(&member, 0, sizeof(member));
+        member.accessFlags = members[i]->accessFlags;
+        member.nameIndex = members[i]->nameIndex;
+        member.descriptorIndex = members[i]->descriptorIndex;
+
+        for (AttributeInfo *attr : members[i]->attributes) {
+            if (cf.getUtf8(attr->nameIndex) != "Code")
+                continue;
+            CodeAttribute *code = static_cast<CodeAttribute *>(attr);
+            member.codeName = code->nameIndex;
+            member.maxStack = code->maxStack;
+            member.maxLocals = code->maxLocals;
+            member.codeLength = code->codeLength;
+            member.codeOffset = append(tail, code->code, code->codeLength);
+
+            for (AttributeInfo *codeAttr : code->attributes) {
+                std::string name = cf.getUtf8(codeAttr->nameIndex);
+                if (name == "LineNumberTable") {
+                    auto table = static_cast<LineNumberTableAttribute *>(codeAttr);
+                    member.linesName = table->nameIndex;
+                    member.linesCount = table->lineNumberTable.size();
+                    member.linesOffset = append(tail,
+                            table->lineNumberTable.data(), member.linesCount);
+                } else if (name == "LocalVariableTable") {
+                    auto table = static_cast<LocalVariableTableAttribute *>(codeAttr);
+                    member.variablesName = table->nameIndex;
+                    member.variablesCount = table->entries.size();
+                    member.variablesOffset = append(tail,
+                            table->entries.data(), member.variablesCount);
+                }
+            }
+        }
+    }
+
+    ClassRecord record;
+    memset(&record, 0, sizeof(record));
+    record.minorVersion = cf.minorVersion;
+    record.majorVersion = cf.majorVersion;
+    record.constantPoolCount = cf.constantPoolCount;
+    record.accessFlags = cf.accessFlags;
+    record.thisClass = cf.thisClass;
+    record.superClass = cf.superClass;
+    record.interfacesCount = cf.interfaces.size();
+    record.fieldsCount = cf.fields.size();
+    record.methodsCount = cf.methods.size();
+
+    data.clear();
+    append(data, &record, 1);
+    record.poolOffset = append(data, pool.data(), pool.size());
+    record.interfacesOffset = append(data, cf.interfaces.data(),
+            cf.interfaces.size());
+    record.membersOffset = append(data, memberRecords.data(),
+            memberRecords.size());
+
+    /* Code and tables were placed from 0, they move behind the members */
+    uint32_t tailOffset = append(data, tail.data(), tail.size());
+    MemberRecord *placed =
+            reinterpret_cast<MemberRecord *>(&data[record.membersOffset]);
+    for (size_t i = 0; i < members.size(); i++) {
+        placed[i].codeOffset += tailOffset;
+        placed[i].linesOffset += tailOffset;
+        placed[i].variablesOffset += tailOffset;
+    }
+    memcpy(&data[0], &record, sizeof(record));
+    return true;
+}
+
+bool SharedArchive::dump(const std::string &path)
+{
+#ifdef HAVE_SYS_STAT_H
+    std::lock_guard<std::mutex> guard(lock);
+
+    /* Classes are parsed once more here, not in the runs using them */
+    std::vector<std::pair<const std::string *, const Source *>> classes;
+    std::vector<std::vector<uint8_t>> records;
+    std::map<std::string, uint32_t> stringIndex;
+    std::vector<std::string> stringList;
+    for (auto &pair : recorded) {
+        if (pair.second.bytes.empty())
+            continue;
+
+        MemoryByteReader reader(pair.second.bytes.data(), pair.second.bytes.size());
+        ClassFile cf = ClassFile::read(&reader);
+        std::vector<uint8_t> data;
+        if (!flatten(cf, data, stringIndex, stringList))
+            continue;
+        classes.push_back(std::make_pair(&pair.first, &pair.second));
+        records.push_back(data);
+    }
+    if (classes.empty())
+        std::cerr << "No classes were archived in " << path << std::endl;
+
+    /* Source paths share the string table, after the Utf8 constants */
+    std::vector<uint32_t> sources;
+    for (auto &item : classes) {
+        const std::string &source = item.second->path;
+        auto added = stringIndex.emplace(source, stringList.size());
+        if (added.second)
+            stringList.push_back(source);
+        sources.push_back(added.first->second);
+    }
+
+    Header header;
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.version = ARCHIVE_VERSION;
+    header.count = classes.size();
+    header.stringCount = stringList.size();
+
+    /* Tables first, then class names, strings and records */
+    std::vector<Entry> table(classes.size());
+    std::vector<StringEntry> stringTable(stringList.size());
+    std::vector<uint8_t> file;
+    append(file, &header, 1);
+    size_t tableOffset = append(file, table.data(), table.size());
+    size_t stringTableOffset = append(file, stringTable.data(), stringTable.size());
+
+    for (size_t i = 0; i < classes.size(); i++) {
+        table[i].nameLength = classes[i].first->length();
+        table[i].nameOffset = append(file, classes[i].first->data(),
+                table[i].nameLength);
+        table[i].sourceIndex = sources[i];
+        table[i].sourceSize = classes[i].second->size;
+        table[i].sourceTime = classes[i].second->time;
+    }
+    for (size_t i = 0; i < stringList.size(); i++) {
+        stringTable[i].length = stringList[i].length();
+        stringTable[i].offset = append(file, stringList[i].data(),
+                stringTable[i].length);
+    }
+    for (size_t i = 0; i < records.size(); i++) {
+        table[i].dataLength = records[i].size();
+        table[i].dataOffset = append(file, records[i].data(), records[i].size());
+    }
+
+    memcpy(&file[tableOffset], table.data(), table.size() * sizeof(Entry));
+    memcpy(&file[stringTableOffset], stringTable.data(),
+            stringTable.size() * sizeof(StringEntry));
+
+    std::ofstream f(path.c_str(), std::ofstream::binary | std::ofstream::trunc);
+    f.write(reinterpret_cast<const char *>(file.data()), file.size());
+    return f.good();
+#else
+    return false;
+#endif
+}
+
+bool SharedArchive::sourceInfo(const std::string &sourcePath,
+        uint64_t &size, int64_t &time)
+{
+#ifdef HAVE_SYS_STAT_H
+    struct stat st;
+    if (sourcePath.empty() || stat(sourcePath.c_str(), &st) != 0)
+        return false;
+
+    size = st.st_size;
+    time = st.st_mtime;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int SharedArchive::compare(const Entry &entry, const std::string &className)
+{
+    size_t common = std::min<size_t>(entry.nameLength, className.length());
+    int order = memcmp(base + entry.nameOffset, className.data(), common);
+    if (order != 0)
+        return order;
+    if (entry.nameLength == className.length())
+        return 0;
+    return entry.nameLength < className.length() ? -1 : 1;
+}
@@ -0,0 +1,47 @@
+#include <cstring>
+
+#include <jvm/stack_arena.h>
+
+StackArena::~StackArena()
+{
+    for (Chunk &c : chunks)
+        delete[] c.data;
+}
+
+uint8_t *StackArena::allocate(size_t size)
+{
+    size = (size + 15) & ~static_cast<size_t>(15);
+
+    while (current < chunks.size() &&
+            offset + size > chunks[current].size) {
+        current++;
+        offset = 0;
+    }
+
+    if (current == chunks.size()) {
+        size_t length = size > chunkSize ? size : chunkSize;
+        chunks.push_back({new uint8_t[length], length});
+        offset = 0;
+    }
+
+    uint8_t *block = chunks[current].data + offset;
+    offset += size;
+
+    /* Chunks are reused after release, clear them each time */
+    memset(block, 0, size);
+    return block;
+}
+
+StackArena::Mark StackArena::mark()
+{
+    Mark m;
+    m.chunk = current;
+    m.offset = offset;
+    return m;
+}
+
+void StackArena::release(Mark m)
+{
+    current = m.chunk;
+    offset = m.offset;
+}
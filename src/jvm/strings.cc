@@ -0,0 +1,101 @@
+#include <vector>
+
+#include <jvm/jvm.h>
+#include <jvm/strings.h>
+
+Object *&Strings::valueOf(Object *str)
+{
+    static Symbol *valueName = Symbol::intern("value");
+
+    Field *value = str->cls->findField(valueName);
+    return *reinterpret_cast<Object **>(&str->fields[value->offset]);
+}
+
+Object *Strings::create(const std::string &utf8)
+{
+    /* Modified UTF-8 from class files, characters outside the BMP come as pairs */
+    std::vector<uint16_t> utf16;
+    for (size_t i = 0; i < utf8.length(); ) {
+        uint8_t c = utf8[i];
+        if (c < 0x80) {
+            utf16.push_back(c);
+            i++;
+        } else if ((c & 0xE0) == 0xC0 && i + 1 < utf8.length()) {
+            utf16.push_back(((c & 0x1F) << 6) | (utf8[i + 1] & 0x3F));
+            i += 2;
+        } else if (i + 2 < utf8.length()) {
+            utf16.push_back(((c & 0x0F) << 12) |
+                    ((utf8[i + 1] & 0x3F) << 6) | (utf8[i + 2] & 0x3F));
+            i += 3;
+        } else {
+            break;
+        }
+    }
+
+    Class *stringClass = ClassCache::getClass("java/lang/String");
+    stringClass->link();
+    ArrayClass *charArray =
+            static_cast<ArrayClass *>(ClassCache::getClass("[C"));
+
+    Object *str = stringClass->newObject();
+    Object *value = charArray->newArray(utf16.size());
+    uint16_t *chars = reinterpret_cast<uint16_t *>(value->fields + INTEGER_SIZE);
+    for (size_t i = 0; i < utf16.size(); i++)
+        chars[i] = utf16[i];
+    valueOf(str) = value;
+
+    return str;
+}
+
+Object *Strings::createArray(const std::vector<std::string> &items)
+{
+    ArrayClass *stringArray = static_cast<ArrayClass *>(
+            ClassCache::getClass("[Ljava/lang/String;"));
+
+    Object *array = stringArray->newArray(items.size());
+    Object **elements = reinterpret_cast<Object **>(array->fields + INTEGER_SIZE);
+    for (size_t i = 0; i < items.size(); i++)
+        elements[i] = create(items[i]);
+
+    return array;
+}
+
+int32_t Strings::length(Object *str)
+{
+    Object *value = valueOf(str);
+    return value == nullptr ? 0 : *reinterpret_cast<int32_t *>(value->fields);
+}
+
+uint16_t *Strings::chars(Object *str)
+{
+    Object *value = valueOf(str);
+    return value == nullptr ? nullptr :
+            reinterpret_cast<uint16_t *>(value->fields + INTEGER_SIZE);
+}
+
+std::string Strings::toUtf8(Object *str)
+{
+    if (str == nullptr)
+        return "null";
+
+    std::string utf8;
+    int32_t count = length(str);
+    uint16_t *data = chars(str);
+    for (int32_t i = 0; i < count; i++)
+        appendUtf8(utf8, data[i]);
+    return utf8;
+}
+
+void Strings::appendUtf8(std::string &utf8, uint16_t c)
+{
+    if (c < 0x80) {
+        utf8 += static_cast<char>(c);
+    } else if (c < 0x800) {
+        utf8 += static_cast<char>(0xC0 | (c >> 6));
+        utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        utf8 += static_cast<char>(0xE0 | (c >> 12));
+        utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include <jvm/jvm.h>
+#include <jvm/isolate.h>
+#include <jvm/safepoint.h>
+#include <jvm/scheduler.h>
+#include <jvm/threads.h>
+
+std::mutex ThreadManager::lock;
+std::condition_variable ThreadManager::doneCond;
+std::map<Object *, ThreadManager::NativeThread> ThreadManager::threads;
+
+void ThreadManager::start(Object *threadObject)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    /* Starting the same thread twice is ignored */
+    if (threads.find(threadObject) != threads.end())
+        return;
+
+    if (!Scheduler::active) {
+        threads[threadObject].thread =
+                std::thread(run, threadObject, Isolate::current());
+        return;
+    }
+
+    threads[threadObject];
+    Method *method = runMethod(threadObject);
+    if (method == nullptr) {
+        threads[threadObject].done = true;
+        return;
+    }
+
+    Thread *task = new Thread(Isolate::current());
+    task->threadObject = threadObject;
+    task->prepare(method, {reinterpret_cast<intptr_t>(threadObject)});
+    Scheduler::submit(task);
+}
+
+Method *ThreadManager::runMethod(Object *threadObject)
+{
+    static Symbol *runName = Symbol::intern("run"),
+            *runDescriptor = Symbol::intern("()V");
+
+    Method *method = nullptr;
+    for (Class *c = threadObject->cls; c != nullptr && method == nullptr;
+            c = c->super)
+        method = c->getMethod(runName, runDescriptor);
+
+    if (method == nullptr || method->code == nullptr)
+        return nullptr;
+    return method;
+}
+
+void ThreadManager::run(Object *threadObject, Isolate *isolate)
+{
+    Method *method = runMethod(threadObject);
+    if (method != nullptr) {
+        Thread thread(isolate);
+        thread.invoke(method, {reinterpret_cast<intptr_t>(threadObject)});
+    }
+
+    finished(threadObject);
+}
+
+void ThreadManager::finished(Object *threadObject)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    NativeThread &nativeThread = threads[threadObject];
+    nativeThread.done = true;
+    doneCond.notify_all();
+    for (Thread *joiner : nativeThread.joiners)
+        Scheduler::wake(joiner);
+    nativeThread.joiners.clear();
+}
+
+void ThreadManager::join(Thread *caller, Object *threadObject)
+{
+    SafeRegion region(caller);
+    std::unique_lock<std::mutex> guard(lock);
+
+    auto findIterator = threads.find(threadObject);
+    if (findIterator == threads.end())
+        return;
+    NativeThread &nativeThread = findIterator->second;
+    if (Scheduler::active) {
+        caller->blocked = !nativeThread.done;
+        if (caller->blocked && std::find(nativeThread.joiners.begin(),
+                nativeThread.joiners.end(), caller) == nativeThread.joiners.end())
+            nativeThread.joiners.push_back(caller);
+        return;
+    }
+    while (!nativeThread.done)
+        doneCond.wait(guard);
+}
+
+void ThreadManager::joinAll()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    /* Threads may start more threads while we are waiting */
+    for (auto it = threads.begin(); it != threads.end(); ) {
+        if (!it->second.thread.joinable()) {
+            ++it;
+            continue;
+        }
+        std::thread joined = std::move(it->second.thread);
+        guard.unlock();
+        joined.join();
+        guard.lock();
+        it = threads.begin();
+    }
+}
@@ -0,0 +1,295 @@
+#include <config.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef HAVE_SYS_UN_H
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <jvm/zygote.h>
+
+int Zygote::listenSocket = -1;
+
+#ifdef HAVE_SYS_UN_H
+static bool socketAddress(const std::string &path, sockaddr_un &address)
+{
+    if (path.length() >= sizeof(address.sun_path))
+        return false;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.length() + 1);
+    return true;
+}
+
+static bool writeAll(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+/* Run output goes to the client in frames: type, 32-bit length, data */
+enum FrameType : uint8_t { FRAME_STDOUT = 1, FRAME_STDERR, FRAME_EXIT };
+static const size_t FRAME_HEADER = 5;
+
+static bool writeFrame(int fd, uint8_t type, const char *data, uint32_t length)
+{
+    char header[FRAME_HEADER] = {(char) type, (char) (length >> 24),
+            (char) (length >> 16), (char) (length >> 8), (char) length};
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, data, length);
+}
+
+/* Copies the runner's output to the client until it exits, then sends
+ * its exit status, 128 + signal number if it was killed */
+static void forward(int connection, int out, int err, pid_t runner)
+{
+    pollfd fds[2] = {{out, POLLIN, 0}, {err, POLLIN, 0}};
+    int open = 2;
+    char buffer[4096];
+    while (open > 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            if (fds[i].fd < 0 || fds[i].revents == 0)
+                continue;
+            ssize_t count = read(fds[i].fd, buffer, sizeof(buffer));
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                open--;
+                continue;
+            }
+            /* A client that went away does not stop the run */
+            writeFrame(connection, i == 0 ? FRAME_STDOUT : FRAME_STDERR,
+                    buffer, count);
+        }
+    }
+
+    int status = 0;
+    while (waitpid(runner, &status, 0) < 0 && errno == EINTR)
+        ;
+    uint32_t code = WIFEXITED(status) ? WEXITSTATUS(status) :
+            128 + WTERMSIG(status);
+    char trailer[4] = {(char) (code >> 24), (char) (code >> 16),
+            (char) (code >> 8), (char) code};
+    writeFrame(connection, FRAME_EXIT, trailer, sizeof(trailer));
+}
+
+static uint32_t frameNumber(const char *data)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    return (uint32_t) bytes[0] << 24 | (uint32_t) bytes[1] << 16 |
+           (uint32_t) bytes[2] << 8 | (uint32_t) bytes[3];
+}
+#endif
+
+bool Zygote::serve(const std::string &socketPath,
+        std::string &className, std::vector<std::string> &args)
+{
+#ifdef HAVE_SYS_UN_H
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address))
+        return false;
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+        return false;
+
+    unlink(socketPath.c_str());
+    if (bind(listenSocket, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0) {
+        close(listenSocket);
+        return false;
+    }
+
+    /* Children are reaped by the kernel, nobody waits for them */
+    signal(SIGCHLD, SIG_IGN);
+
+    while (true) {
+        int connection = accept(listenSocket, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            close(listenSocket);
+            return false;
+        }
+
+        /* Buffered output would otherwise be written by every child */
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listenSocket);
+            signal(SIGCHLD, SIG_DFL);
+            if (!readRequest(connection, className, args))
+                _exit(1);
+
+            /* This child waits for the run to report how it ended */
+            int out[2], err[2];
+            if (pipe(out) != 0 || pipe(err) != 0)
+                _exit(1);
+            pid_t runner = fork();
+            if (runner < 0)
+                _exit(1);
+            if (runner == 0) {
+                dup2(out[1], STDOUT_FILENO);
+                dup2(err[1], STDERR_FILENO);
+                close(out[0]);
+                close(out[1]);
+                close(err[0]);
+                close(err[1]);
+                close(connection);
+                return true;
+            }
+
+            signal(SIGPIPE, SIG_IGN);
+            close(out[1]);
+            close(err[1]);
+            forward(connection, out[0], err[0], runner);
+            _exit(0);
+        }
+
+        if (pid < 0)
+            std::cerr << "Zygote: fork failed: " << strerror(errno) << std::endl;
+        close(connection);
+    }
+#else
+    return false;
+#endif
+}
+
+bool Zygote::readRequest(int fd, std::string &className,
+        std::vector<std::string> &args)
+{
+#ifdef HAVE_SYS_UN_H
+    /* Working directory, class name, argument count and arguments,
+     * each ending with NUL */
+    std::vector<std::string> items;
+    std::string item;
+    char buffer[4096];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        for (ssize_t i = 0; i < count; i++) {
+            if (buffer[i] != '\0') {
+                item += buffer[i];
+                continue;
+            }
+            items.push_back(item);
+            item.clear();
+
+            if (items.size() >= 3 &&
+                    items.size() == 3 + strtoul(items[2].c_str(), nullptr, 10)) {
+                /* Classes not loaded yet are found relative to the client */
+                if (chdir(items[0].c_str()) != 0)
+                    return false;
+                className = items[1];
+                args.assign(items.begin() + 3, items.end());
+                return true;
+            }
+        }
+    }
+#else
+    return false;
+#endif
+}
+
+bool Zygote::request(const std::string &socketPath,
+        const std::string &className, const std::vector<std::string> &args,
+        int &status)
+{
+#ifdef HAVE_SYS_UN_H
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address))
+        return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+        close(fd);
+        return false;
+    }
+
+    std::string message = std::string(cwd) + '\0' + className + '\0' +
+            std::to_string(args.size()) + '\0';
+    for (const std::string &arg : args)
+        message += arg + '\0';
+    if (!writeAll(fd, message.data(), message.length())) {
+        close(fd);
+        return false;
+    }
+    shutdown(fd, SHUT_WR);
+
+    /* A run that never reported its status has failed */
+    status = 1;
+    std::string frames;
+    char buffer[4096];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            break;
+        frames.append(buffer, count);
+
+        size_t used = 0;
+        while (frames.length() - used >= FRAME_HEADER) {
+            uint8_t type = frames[used];
+            uint32_t length = frameNumber(&frames[used + 1]);
+            if (frames.length() - used - FRAME_HEADER < length)
+                break;
+
+            const char *data = &frames[used + FRAME_HEADER];
+            if (type == FRAME_STDOUT)
+                writeAll(STDOUT_FILENO, data, length);
+            else if (type == FRAME_STDERR)
+                writeAll(STDERR_FILENO, data, length);
+            else if (type == FRAME_EXIT && length == 4)
+                status = frameNumber(data);
+            used += FRAME_HEADER + length;
+        }
+        frames.erase(0, used);
+    }
+
+    close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+
+#include <class/java_class_builder.h>
+#include <jvm/jvm.h>
+#include <jvm/embed.h>
+
+/*
+ * Derived.<clinit> must not run before Base.<clinit> has returned, even
+ * when Base.<clinit> calls a method or initializes another class first.
+ *
+ *   class Other   { static int Z = 1; }
+ *   class Base    { static int X = compute() + Other.Z;
+ *                   static int compute() { return 42; } }
+ *   class Derived extends Base { static int Y = Base.X;
+ *                                static int get() { return Y; } }
+ */
+
+static ClassFile *otherClass()
+{
+    ClassBuilder cb("Other");
+    cb.addField("Z", "I", ACC_STATIC);
+    MethodBuilder *mb = cb.createMethod("<clinit>");
+    mb->setDescriptor("()V");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(1, 0);
+    mb->loadInteger(1);
+    mb->field(opcodes::PUTSTATIC, "Other", "Z", "I");
+    mb->instruction(opcodes::RETURN);
+    return cb.build();
+}
+
+static ClassFile *baseClass()
+{
+    ClassBuilder cb("Base");
+    cb.addField("X", "I", ACC_STATIC);
+
+    MethodBuilder *mb = cb.createMethod("compute");
+    mb->setDescriptor("()I");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(1, 0);
+    mb->loadInteger(42);
+    mb->instruction(opcodes::IRETURN);
+
+    mb = cb.createMethod("<clinit>");
+    mb->setDescriptor("()V");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(2, 0);
+    mb->invoke(opcodes::INVOKESTATIC, "Base", "compute", "()I");
+    mb->field(opcodes::GETSTATIC, "Other", "Z", "I");
+    mb->instruction(opcodes::IADD);
+    mb->field(opcodes::PUTSTATIC, "Base", "X", "I");
+    mb->instruction(opcodes::RETURN);
+    return cb.build();
+}
+
+static ClassFile *derivedClass()
+{
+    ClassBuilder cb("Derived");
+    cb.setSuper("Base");
+    cb.addField("Y", "I", ACC_STATIC);
+
+    MethodBuilder *mb = cb.createMethod("<clinit>");
+    mb->setDescriptor("()V");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(1, 0);
+    mb->field(opcodes::GETSTATIC, "Base", "X", "I");
+    mb->field(opcodes::PUTSTATIC, "Derived", "Y", "I");
+    mb->instruction(opcodes::RETURN);
+
+    mb = cb.createMethod("get");
+    mb->setDescriptor("()I");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(1, 0);
+    mb->field(opcodes::GETSTATIC, "Derived", "Y", "I");
+    mb->instruction(opcodes::IRETURN);
+    return cb.build();
+}
+
+int main()
+{
+    ClassLoader::defineClass(otherClass());
+    ClassLoader::defineClass(baseClass());
+    ClassLoader::defineClass(derivedClass());
+
+    MethodHandle get = MethodHandle::find("Derived", "get", "()I");
+    int32_t y = CallContext::current().callInt(get);
+    if (y != 43) {
+        std::cerr << "Derived.Y = " << y << ", expected 43" << std::endl;
+        return 1;
+    }
+    return 0;
+}
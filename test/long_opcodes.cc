@@ -0,0 +1,124 @@
+#include <iostream>
+
+#include <class/java_class_builder.h>
+#include <jvm/jvm.h>
+#include <jvm/embed.h>
+
+/*
+ * Long constants, locals, arithmetic and comparisons, with the long
+ * Math and System intrinsics called from bytecode.
+ *
+ *   class Longs {
+ *       static long big() { return 5000000000L - 1; }
+ *       static int check() {
+ *           long x = big(), y = x + 2;
+ *           if (Math.abs(0 - y) != y) return -1;
+ *           if (Math.max(x, y) != y || Math.min(x, y) != x) return -2;
+ *           if ((int) Math.abs((long) -7) - 7 != 0) return -3;
+ *           long t = System.nanoTime();
+ *           if (System.nanoTime() < t) return -4;
+ *           System.currentTimeMillis();
+ *           return (int) y;
+ *       }
+ *   }
+ */
+
+static const char *ABS = "(J)J", *MAX_MIN = "(JJ)J";
+
+static ClassFile *longsClass()
+{
+    ClassBuilder cb("Longs");
+
+    MethodBuilder *mb = cb.createMethod("big");
+    mb->setDescriptor("()J");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(4, 0);
+    mb->loadLong(5000000000LL);
+    mb->loadLong(1);
+    mb->instruction(opcodes::LSUB);
+    mb->instruction(opcodes::LRETURN);
+
+    mb = cb.createMethod("check");
+    mb->setDescriptor("()I");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(4, 7);
+    Label *failed = new Label;
+
+    mb->invoke(opcodes::INVOKESTATIC, "Longs", "big", "()J");
+    mb->local(opcodes::LSTORE, 0);
+    mb->local(opcodes::LLOAD, 0);
+    mb->loadLong(2);
+    mb->instruction(opcodes::LADD);
+    mb->local(opcodes::LSTORE, 2);
+
+    mb->loadInteger(-1);
+    mb->local(opcodes::ISTORE, 6);
+    mb->loadLong(0);
+    mb->local(opcodes::LLOAD, 2);
+    mb->instruction(opcodes::LSUB);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/Math", "abs", ABS);
+    mb->local(opcodes::LLOAD, 2);
+    mb->instruction(opcodes::LCMP);
+    mb->jump(opcodes::IFNE, failed);
+
+    mb->loadInteger(-2);
+    mb->local(opcodes::ISTORE, 6);
+    mb->local(opcodes::LLOAD, 0);
+    mb->local(opcodes::LLOAD, 2);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/Math", "max", MAX_MIN);
+    mb->local(opcodes::LLOAD, 2);
+    mb->instruction(opcodes::LCMP);
+    mb->jump(opcodes::IFNE, failed);
+    mb->local(opcodes::LLOAD, 0);
+    mb->local(opcodes::LLOAD, 2);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/Math", "min", MAX_MIN);
+    mb->local(opcodes::LLOAD, 0);
+    mb->instruction(opcodes::LCMP);
+    mb->jump(opcodes::IFNE, failed);
+
+    mb->loadInteger(-3);
+    mb->local(opcodes::ISTORE, 6);
+    mb->loadInteger(-7);
+    mb->instruction(opcodes::I2L);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/Math", "abs", ABS);
+    mb->instruction(opcodes::L2I);
+    mb->loadInteger(7);
+    mb->instruction(opcodes::ISUB);
+    mb->jump(opcodes::IFNE, failed);
+
+    mb->loadInteger(-4);
+    mb->local(opcodes::ISTORE, 6);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/System", "nanoTime", "()J");
+    mb->local(opcodes::LSTORE, 4);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/System", "nanoTime", "()J");
+    mb->local(opcodes::LLOAD, 4);
+    mb->instruction(opcodes::LCMP);
+    mb->jump(opcodes::IFLT, failed);
+    mb->invoke(opcodes::INVOKESTATIC, "java/lang/System",
+            "currentTimeMillis", "()J");
+    mb->instruction(opcodes::POP2);
+
+    mb->local(opcodes::LLOAD, 2);
+    mb->instruction(opcodes::L2I);
+    mb->instruction(opcodes::IRETURN);
+
+    mb->insertLabel(failed);
+    mb->local(opcodes::ILOAD, 6);
+    mb->instruction(opcodes::IRETURN);
+    return cb.build();
+}
+
+int main()
+{
+    ClassLoader::defineClass(longsClass());
+
+    MethodHandle check = MethodHandle::find("Longs", "check", "()I");
+    int32_t result = CallContext::current().callInt(check);
+    /* 5000000001 truncated to an int */
+    if (result != 705032705) {
+        std::cerr << "Longs.check() = " << result << ", expected 705032705"
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
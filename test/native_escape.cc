@@ -0,0 +1,62 @@
+#include <iostream>
+#include <vector>
+
+#include <class/java_class_builder.h>
+#include <jvm/jvm.h>
+#include <jvm/embed.h>
+#include <jvm/natives.h>
+
+/*
+ * A native bound over a method with bytecode keeps what it is given,
+ * so objects passed to it must not live in the caller's frame.
+ *
+ *   class Cache {
+ *       static void put(Object o) {}    // bound to keep()
+ *       static void run() { put(new Cache()); }
+ *   }
+ */
+
+static std::vector<Object *> kept;
+
+static intptr_t keep(Thread *thread, intptr_t *args)
+{
+    kept.push_back(reinterpret_cast<Object *>(args[0]));
+    return 0;
+}
+
+static ClassFile *cacheClass()
+{
+    ClassBuilder cb("Cache");
+
+    MethodBuilder *mb = cb.createMethod("put");
+    mb->setDescriptor("(Ljava/lang/Object;)V");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(0, 1);
+    mb->instruction(opcodes::RETURN);
+
+    mb = cb.createMethod("run");
+    mb->setDescriptor("()V");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(1, 0);
+    mb->type(opcodes::NEW, "Cache");
+    mb->invoke(opcodes::INVOKESTATIC, "Cache", "put", "(Ljava/lang/Object;)V");
+    mb->instruction(opcodes::RETURN);
+    return cb.build();
+}
+
+int main()
+{
+    Natives::add("Cache", "put", "(Ljava/lang/Object;)V", keep);
+    Class *cls = ClassLoader::defineClass(cacheClass());
+
+    MethodHandle run = MethodHandle::find("Cache", "run", "()V");
+    CallContext::current().callVoid(run);
+    CallContext::current().callVoid(run);
+
+    if (kept.size() != 2 || kept[0] == kept[1] ||
+            kept[0]->cls != cls || kept[1]->cls != cls) {
+        std::cerr << "Objects passed to a native were frame-allocated" << std::endl;
+        return 1;
+    }
+    return 0;
+}
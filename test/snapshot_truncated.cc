@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include <class/java_class_builder.h>
+#include <jvm/jvm.h>
+#include <jvm/embed.h>
+#include <jvm/heap_snapshot.h>
+#include <jvm/isolate.h>
+
+/*
+ * A heap snapshot cut short, or with bytes after its end, is rejected
+ * whatever the length; the complete one restores the statics.
+ *
+ *   class Holder {
+ *       static int[] items;
+ *       static String name;
+ *       static void fill() { items = new int[3]; items[0] = 7; name = "snap"; }
+ *   }
+ */
+
+static const char *SNAPSHOT_PATH = "snapshot_truncated.heap";
+
+static ClassFile *holderClass()
+{
+    ClassBuilder cb("Holder");
+    cb.addField("items", "[I", ACC_STATIC);
+    cb.addField("name", "Ljava/lang/String;", ACC_STATIC);
+
+    MethodBuilder *mb = cb.createMethod("fill");
+    mb->setDescriptor("()V");
+    mb->setAccessFlags(ACC_STATIC);
+    mb->setMax(3, 0);
+    mb->loadInteger(3);
+    mb->instruction(opcodes::NEWARRAY);
+    mb->instruction(T_INT);
+    mb->field(opcodes::PUTSTATIC, "Holder", "items", "[I");
+    mb->field(opcodes::GETSTATIC, "Holder", "items", "[I");
+    mb->loadInteger(0);
+    mb->loadInteger(7);
+    mb->instruction(opcodes::IASTORE);
+    mb->loadString("snap");
+    mb->field(opcodes::PUTSTATIC, "Holder", "name", "Ljava/lang/String;");
+    mb->instruction(opcodes::RETURN);
+    return cb.build();
+}
+
+static void writeFile(const std::vector<uint8_t> &bytes, size_t length)
+{
+    std::ofstream f(SNAPSHOT_PATH, std::ofstream::binary | std::ofstream::trunc);
+    f.write(reinterpret_cast<const char *>(bytes.data()), length);
+}
+
+static int32_t firstItem(Isolate *isolate, Class *cls)
+{
+    for (Field &field : cls->fields) {
+        if (field.name->str != "items")
+            continue;
+        Object *items = *reinterpret_cast<Object **>(
+                &isolate->state(cls)->staticFields[field.offset]);
+        return items != nullptr ?
+                reinterpret_cast<int32_t *>(items->fields + INTEGER_SIZE)[0] : 0;
+    }
+    return 0;
+}
+
+int main()
+{
+    Class *cls = ClassLoader::defineClass(holderClass());
+    CallContext::current().callVoid(MethodHandle::find("Holder", "fill", "()V"));
+    if (!HeapSnapshot::save(SNAPSHOT_PATH, Isolate::main())) {
+        std::cerr << "Could not save the snapshot" << std::endl;
+        return 1;
+    }
+
+    std::ifstream f(SNAPSHOT_PATH, std::ifstream::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)),
+            std::istreambuf_iterator<char>());
+    f.close();
+
+    int failures = 0;
+    for (size_t length = 0; length < bytes.size(); length++) {
+        writeFile(bytes, length);
+        if (HeapSnapshot::restore(SNAPSHOT_PATH, new Isolate)) {
+            std::cerr << "Snapshot cut to " << length << " of "
+                      << bytes.size() << " bytes was restored" << std::endl;
+            failures++;
+        }
+    }
+
+    std::vector<uint8_t> longer(bytes);
+    longer.push_back(0);
+    writeFile(longer, longer.size());
+    if (HeapSnapshot::restore(SNAPSHOT_PATH, new Isolate)) {
+        std::cerr << "Snapshot with a trailing byte was restored" << std::endl;
+        failures++;
+    }
+
+    writeFile(bytes, bytes.size());
+    Isolate *isolate = new Isolate;
+    if (!HeapSnapshot::restore(SNAPSHOT_PATH, isolate) ||
+            firstItem(isolate, cls) != 7) {
+        std::cerr << "Complete snapshot was not restored" << std::endl;
+        failures++;
+    }
+
+    std::remove(SNAPSHOT_PATH);
+    return failures == 0 ? 0 : 1;
+}